@@ -34,10 +34,11 @@ void Setup_Pins_24bitMode(void)
 {
 #ifdef GPIO_EXTENDER_MODE
 	//setup the mcp23008, as its the source of everything xD
-	mcp23008_init(ADDR_CHIP_1);
-	mcp23008_init(ADDR_CHIP_2);
-	mcp23008_init(DATA_CHIP_1);	
+	InitExpander(ADDR_CHIP_1);
+	InitExpander(ADDR_CHIP_2);
+	InitExpander(DATA_CHIP_1);	
 #endif	
+	ResetBusState();
 	SetAddressPinsAsOutput();
 	
 	//setup data pins as input
@@ -92,8 +93,7 @@ inline uint16_t Read24BitIncrementedBytes(int8_t LatchAddress,uint32_t address)
 	}
 	
 	ClearPin(CTRL_PORT,RD);
-	asm("nop");
-	asm("nop");
+	BUS_SETTLE(_bus_settle);
 	
 	GET_ADDR1_DATA(d2);
 	GET_ADDR2_DATA(d1);
@@ -101,6 +101,27 @@ inline uint16_t Read24BitIncrementedBytes(int8_t LatchAddress,uint32_t address)
 	SetPin(CTRL_PORT,RD);
 	return (uint16_t)d1 << 8 | d2;
 }
+#ifndef GPIO_EXTENDER_MODE
+//checksum of the nintendo logo in the GBA header (0x04 - 0xA0), read using the increment read
+uint16_t _ReadGBALogo(void)
+{
+	uint16_t sum = 0;
+	for(uint8_t i = 0;i < 0x4E;i++)
+	{
+		uint16_t data = Read24BitIncrementedBytes(i == 0,0x02);
+		BUS_CHECKSUM(sum,data);
+	}
+	SetPin(CTRL_PORT,CS1);
+	return sum;
+}
+#endif
+//picks the bus settle time for the inserted cart
+void CalibrateGBABusTiming(void)
+{
+#ifndef GPIO_EXTENDER_MODE
+	CalibrateBusTiming(_ReadGBALogo);
+#endif
+}
 inline uint16_t Read24BitBytes(uint32_t address)
 {
 	uint16_t data = Read24BitIncrementedBytes(1,address);
@@ -239,6 +260,10 @@ int8_t GetGBAInfo(char* name, uint8_t* cartFlag)
 {
 	if(name == NULL || cartFlag == NULL)
 		return ERR_NO_INFO;
+#ifdef NO_GBA_SUPPORT
+	*cartFlag = GBA_SAVE_NONE;
+	return ERR_FAULT_CART;
+#endif
 	
 	GBA_Header info;
 	uint16_t* ptr = (uint16_t*)&info;
@@ -307,7 +332,7 @@ uint32_t GetGBARamSize(uint8_t* RamType)
 	
 	//size calculation for flash & Sram
 	//Sram only has one size (on paper...). if we read past 0x8000 we would see that it is a mirror of 0x0000	
-	Setup_Pins_8bitMode();
+	SwitchBusMode();
 	uint16_t duplicates = 0;
 	for(uint16_t i = 0;i < 0x400;i++)
 	{
@@ -361,7 +386,7 @@ uint32_t GetGBARamSize(uint8_t* RamType)
 uint8_t GBA_CheckForSave(void)
 {
 	//set to 8bit mode
-	Setup_Pins_8bitMode();
+	SwitchBusMode();
 	//read 32x64 bytes and check for bogus
 	uint16_t addr = 0x00;
 	uint8_t zeroes = 0;
@@ -378,13 +403,13 @@ uint8_t GBA_CheckForSave(void)
 		}
 		if(x == 0 && zeroes >= 63)
 		{
-			Setup_Pins_24bitMode();
+			SwitchBusMode();
 			return GBA_SAVE_NONE;
 		}
 		addr += 0x400;
 	}
 
-	Setup_Pins_24bitMode();
+	SwitchBusMode();
 	return GBA_SAVE_SRAM_FLASH;
 }
 uint8_t GBA_CheckForSramOrFlash(void)
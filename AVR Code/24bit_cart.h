@@ -87,6 +87,7 @@ typedef struct _GBA_Header
 
 void Setup_Pins_24bitMode(void);
 uint16_t Read24BitIncrementedBytes(int8_t LatchAddress,uint32_t address);
+void CalibrateGBABusTiming(void);
 void Set24BitAddress(uint32_t address);
 void SetEepromRamAddress(uint16_t address, int8_t eeprom_type);
 void ReadEepromRamByte(uint16_t address, int8_t eeprom_type, uint8_t* buffer);
@@ -19,6 +19,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <string.h>
 #include <ctype.h>
 #include <stdint.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
 #include "gb_error.h"
 #include "8bit_cart.h"
 #include "gb_pins.h"
@@ -27,20 +29,51 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "mcp23008.h"
 #endif
 
+#ifdef SHIFTING_MODE
+//last upper address byte latched into the 595, so it isn't shifted out again if it didn't change
+uint8_t _addr_high = 0;
+
+//shifts a byte into both 595's and latches it on the one selected by latch.
+//cycle counts, from the instructions (not measured) :
+//	SPI @ F_CPU/2 : out SPDR (1) + 16 cycles shifting + ~3 polling SPIF + 4 for the latch pulse = ~24 cycles per byte.
+//	                a low byte update is ~3us @ 8Mhz (1.5us @ 16Mhz), a full address ~6us (3us).
+//	the old bit banged loop with its _delay_us(1) per clock was ~19 cycles per bit @ 8Mhz, or ~38us for every address.
+inline void _ShiftAddressByte(uint8_t data,uint8_t latch)
+{
+	SPDR = data;
+	while(!(SPSR & (1 << SPIF)));
+	
+	//the rising edge on RCLK moves the shifted byte to the outputs
+	SetPin(ADDR_CTRL_PORT,latch);
+	ClearPin(ADDR_CTRL_PORT,latch);
+}
+#endif
 void Setup_Pins_8bitMode(void)
 {
 #ifdef GPIO_EXTENDER_MODE
 	//setup the mcp23008, as its the source of everything xD
-	mcp23008_init(ADDR_CHIP_1);
-	mcp23008_init(ADDR_CHIP_2);
-	mcp23008_init(DATA_CHIP_1);
+	InitExpander(ADDR_CHIP_1);
+	InitExpander(ADDR_CHIP_2);
+	InitExpander(DATA_CHIP_1);
 	
 #elif defined(SHIFTING_MODE)
-	//set the pins as output, init-ing the pins for the shift register
-	ADDR_CTRL_DDR |= ( (1 << ADDR_CTRL_DATA) | (1 << ADDR_CTRL_CLK) | (1 << ADDR_CTRL_LATCH) );	
+	//set the latch pins as output
+	ADDR_CTRL_DDR |= ( (1 << ADDR_CTRL_LATCH) | (1 << ADDR_CTRL_LATCH_HIGH) );
+	ADDR_CTRL_PORT &= ~( (1 << ADDR_CTRL_LATCH) | (1 << ADDR_CTRL_LATCH_HIGH) );
+	
+	//setup the SPI as master, MSB first, mode 0 @ F_CPU/2. SS has to be an output or the SPI can drop out of master mode
+	SPI_DDR |= ( (1 << SPI_SS) | (1 << SPI_MOSI) | (1 << SPI_SCK) );
+	SPCR = (1 << SPE) | (1 << MSTR);
+	SPSR = (1 << SPI2X);
+	
+	//put both registers in a known state
+	_ShiftAddressByte(0x00,ADDR_CTRL_LATCH_HIGH);
+	_ShiftAddressByte(0x00,ADDR_CTRL_LATCH);
+	_addr_high = 0x00;
 #endif	
 
 	//set address pins as output
+	ResetBusState();
 	SetAddressPinsAsOutput();
 	//setup data pins as input
 	SetDataPinsAsInput(); 
@@ -60,38 +93,20 @@ inline void Set8BitAddress(uint16_t address)
 {	
 #ifdef GPIO_EXTENDER_MODE	
 	//write lower address
-	mcp23008_WriteReg(ADDR_CHIP_1,GPIO,(uint8_t)(address & 0xFF));
+	WriteExpanderReg(ADDR_CHIP_1,GPIO,(uint8_t)(address & 0xFF));
 	
 	//write upper address
-	mcp23008_WriteReg(ADDR_CHIP_2,GPIO,address >> 8);
+	WriteExpanderReg(ADDR_CHIP_2,GPIO,address >> 8);
 
 #elif defined(SHIFTING_MODE)
-
-	//write the 16 bits to the shift register
-	ClearPin(ADDR_CTRL_PORT,ADDR_CTRL_LATCH);
-	for(uint8_t i=0;i<16;i++)
+	//the upper byte only changes every 0x100 bytes when dumping, so skip it when it is already set
+	uint8_t high = address >> 8;
+	if(high != _addr_high)
 	{
-		if(address & 0b1000000000000000)
-		{
-			//set the data bit as high
-			SetPin(ADDR_CTRL_PORT,ADDR_CTRL_DATA);
-		}
-		else
-		{
-			//set the data bit as low
-			ClearPin(ADDR_CTRL_PORT,ADDR_CTRL_DATA);
-		}
-		
-		//pulse the shifting register to set the bit
-		SetPin(ADDR_CTRL_PORT,ADDR_CTRL_CLK);
-		_delay_us(1);
-		ClearPin(ADDR_CTRL_PORT,ADDR_CTRL_CLK);
-		
-		//shift with 1 bit, so we can take on the next bit
-		address = address << 1;
-	}	
-	//all bits transfered. time to let the shifting register latch the data and set the pins accordingly
-	SetPin(ADDR_CTRL_PORT,ADDR_CTRL_LATCH);
+		_ShiftAddressByte(high,ADDR_CTRL_LATCH_HIGH);
+		_addr_high = high;
+	}
+	_ShiftAddressByte((uint8_t)(address & 0xFF),ADDR_CTRL_LATCH);
 	
 #else //#elif defined(NORMAL_MODE)
 	uint8_t adr2 = address >> 8;
@@ -101,9 +116,21 @@ inline void Set8BitAddress(uint16_t address)
 	ADDR_PORT2 = adr2;
 #endif
 }
+//only changes the lower address byte, for when we know the upper byte is already set
+inline void Set8BitAddressLow(uint8_t address)
+{
+#ifdef GPIO_EXTENDER_MODE
+	WriteExpanderReg(ADDR_CHIP_1,GPIO,address);
+#elif defined(SHIFTING_MODE)
+	_ShiftAddressByte(address,ADDR_CTRL_LATCH);
+#else
+	ADDR_PORT1 = address;
+#endif
+}
 inline uint8_t _Read8BitByte(uint8_t CS_Pin, uint16_t address)
 {
 	uint8_t data = 0;
+	SetDataPinsAsInput();
 		
 	//pass Address to cartridge via the address bus
 	Set8BitAddress(address);
@@ -124,15 +151,82 @@ inline uint8_t _Read8BitByte(uint8_t CS_Pin, uint16_t address)
 	
 	return data;
 }
+#ifndef GPIO_EXTENDER_MODE
+uint16_t _calibration_sum = 0;
+void _CalibrationSink(uint8_t data)
+{
+	BUS_CHECKSUM(_calibration_sum,data);
+}
+uint16_t _ReadGBLogo(void)
+{
+	_calibration_sum = 0;
+	ReadGBRomBlock(_ADDR_LOGO,_ADDR_NAME - _ADDR_LOGO,_CalibrationSink);
+	return _calibration_sum;
+}
+#endif
+//picks the bus settle time for the inserted cart, using the nintendo logo in the header
+void CalibrateGBBusTiming(void)
+{
+#ifndef GPIO_EXTENDER_MODE
+	CalibrateBusTiming(_ReadGBLogo);
+#endif
+}
+//reads length bytes starting from address, for dumping.
+//since we walk the addresses in order, the upper address byte only needs to be written every 0x100 bytes
+void Read8BitBlock(uint8_t CS_Pin, uint16_t address, uint16_t length, api_sink sink)
+{
+	if(length == 0)
+		return;
+	
+	//keep the settle time in a register, so testing it costs no more then the nops it replaced
+	uint8_t settle = _bus_settle;
+	SetDataPinsAsInput();
+	Set8BitAddress(address);
+	while(1)
+	{
+		uint8_t data = 0;
+		if(CS_Pin != 0)
+			ClearPin(CTRL_PORT,CS_Pin);
+		ClearPin(CTRL_PORT,RD);
+		
+		GET_DATA_SETTLED(data,settle);
+		
+		SetPin(CTRL_PORT,RD);
+		if(CS_Pin != 0)
+			SetPin(CTRL_PORT,CS_Pin);
+		
+		sink(data);
+		if(--length == 0)
+			break;
+		
+		address++;
+		if((address & 0xFF) == 0)
+			Set8BitAddress(address);
+		else
+			Set8BitAddressLow(address & 0xFF);
+	}
+}
+void ReadGBRamBlock(uint16_t address, uint16_t length, api_sink sink)
+{
+	//MBC2 only has the lower 4 bits as data, which ReadGBRamByte takes care of
+	if(LoadedMBC.RamMask != 0xFF)
+	{
+		for(;length > 0;length--)
+			sink(ReadGBRamByte(address++));
+		return;
+	}
+	
+	Read8BitBlock(CS1,address,length,sink);
+}
 uint8_t ReadGBRamByte(uint16_t address)
 {
-	if(LoadedBankType == MBC_NONE || LoadedBankType == MBC_UNSUPPORTED)
+	if(!(LoadedMBC.Flags & MBC_FLAG_RAM))
 		return ERR_NO_MBC;
 	
 	uint8_t ret = _Read8BitByte(CS1,address);
 	
 	//MBC2 only has the lower 4 bits as data, so we return it as 0xFx
-	return (LoadedBankType == MBC2)?(0xF0 | ret ):ret;
+	return ret | ~LoadedMBC.RamMask;
 }
 
 inline void _Write8BitByte(uint8_t CS_Pin, uint16_t addr,uint8_t byte)
@@ -152,13 +246,13 @@ inline void _Write8BitByte(uint8_t CS_Pin, uint16_t addr,uint8_t byte)
 	if(CS_Pin != 0)
 		SetPin(CTRL_PORT,CS_Pin);
 	
-	SetDataPinsAsInput();
-	
+	//the data bus stays an output, so writing a run of bytes doesn't flip it every byte.
+	//every read switches it back to input before RD goes low
 	return;
 }
 int8_t WriteGBRamByte(uint16_t addr,uint8_t byte)
 {
-	if(LoadedBankType == MBC_NONE || LoadedBankType == MBC_UNSUPPORTED)
+	if(!(LoadedMBC.Flags & MBC_FLAG_RAM))
 		return ERR_NO_MBC;
 		
 	_Write8BitByte(CS1,addr,byte);
@@ -168,88 +262,230 @@ int8_t WriteGBRamByte(uint16_t addr,uint8_t byte)
 //--------------------------------------
 //			GB Functions
 //--------------------------------------
+//rom bank that is in the switchable region, so the dump loops only switch when they have to. 0xFFFF means unknown
+uint16_t _rom_bank = 0xFFFF;
+//MBC5 bank bit 8 that is in 0x3000. 0xFF means unknown
+uint8_t _rom_bank_high = 0xFF;
+
+void ResetGBCart(void)
+{
+	//CS2 is the cart's reset. this causes all banks & states to reset
+	ClearPin(CTRL_PORT,CS2);
+	SetPin(CTRL_PORT,CS2);
+	_rom_bank = 0xFFFF;
+	_rom_bank_high = 0xFF;
+}
 int8_t OpenGBRam(void)
 {
-	if(LoadedBankType == MBC_NONE || LoadedBankType == MBC_UNSUPPORTED)
+	if(!(LoadedMBC.Flags & MBC_FLAG_RAM))
 		return ERR_NO_MBC;
 	
 	SetPin(CTRL_PORT,WD);
 	SetPin(CTRL_PORT,RD);
 	SetPin(CTRL_PORT,CS1);	
 	
-	if(LoadedBankType == MBC2)
-	{
-		//the ghost read fix from https://www.insidegadgets.com/2011/03/28/gbcartread-arduino-based-gameboy-cart-reader-%E2%80%93-part-2-read-the-ram/
-		//he said it otherwise had issues with MBC2? :/
-		ReadGBRomByte(0x0134);
-	}
-		
-	//set banking mode to RAM
-	if(LoadedBankType == MBC1)
-		WriteGBRomByte(0x6000,0x01);
-	
-	//Init the MBC Ram!
-	//uint16_t init_addr = 0x0000; 
-	WriteGBRomByte(0x0000,0x0A);
-	
+	LoadedMBC.OpenRam();
 	return 1;
 }
 void CloseGBRam(void)
 {	
-	uint8_t Bank_Type = LoadedBankType;
 	//disable RAM again - VERY IMPORTANT -
-	if(Bank_Type == MBC1)
-		WriteGBRomByte(0x6000,0x00);
-		
-	//uint16_t init_addr = 0x0000;
-	WriteGBRomByte(0x0000,0x00);
+	LoadedMBC.CloseRam();
+}
 
+//mapper drivers
+//-------------------------
+void _NoRomBank(uint16_t bank)
+{
 	return;
 }
-void SwitchROMBank(int8_t bank)
-{	
-	uint8_t Bank_Type = LoadedBankType;
+void _NoRamBank(int8_t bank)
+{
+	return;
+}
+void _NoRamControl(void)
+{
+	return;
+}
+void _SwitchRamBank(int8_t bank)
+{
+	WriteGBRomByte(0x4000,bank);
+}
+void _EnableRam(void)
+{
+	WriteGBRomByte(0x0000,0x0A);
+}
+void _DisableRam(void)
+{
+	WriteGBRomByte(0x0000,0x00);
+}
+//MBC1 can't map the banks with the lower 5 bits 0 (0x20, 0x40 & 0x60) at 0x4000, those read as the bank after it.
+//in mode 1 the upper bits also select the bank at 0x0000 though, so those banks are mapped & read there.
+//MBC1M multicarts only have 4 bits of the lower register wired, so there it goes for 0x10, 0x20 & 0x30
+void _MBC1SwitchROMBank(uint16_t bank)
+{
+	uint8_t shift = (LoadedMBC.Type == MBC1M)?4:5;
+	uint8_t low = bank & ((1 << shift) - 1);
 	
-	if(Bank_Type == MBC_NONE)
-		return;
-
-	//first some preperations
-	uint16_t addr = 0x2100;
-	uint16_t addr2 = 0x4000;
-	 
-	if(Bank_Type == MBC1)
-		addr = 0x2000;
-	else if(Bank_Type == MBC5)
-		addr2 = 0x3000;
-	
-	switch(Bank_Type)
+	WriteGBRomByte(0x6000,(low == 0)?0x01:0x00);
+	WriteGBRomByte(0x4000,bank >> shift);
+	WriteGBRomByte(0x2000,low);
+}
+//MBC1M multicarts have the header of a 1MB MBC1, but every game has its own header & logo. 
+//with the upper bits set to 1 in mode 1, a MBC1M maps bank 0x10 (the 2nd game) at 0x0000, where a MBC1 maps bank 0x20
+int8_t _MBC1IsMulticart(uint8_t* logo)
+{
+	int8_t ret = 1;
+	WriteGBRomByte(0x6000,0x01);
+	WriteGBRomByte(0x4000,0x01);
+	for(uint8_t i = 0;i < 0x30 && ret;i++)
 	{
-		case MBC1:
-			//in MBC1 we need to 
-			// - set 0x6000 in rom mode 
-			//WriteGBRomByte(0x6000,0);
-			WriteGBRomByte(addr,bank & 0x1F);
-			WriteGBRomByte(addr2,bank >> 5);
-			break;
-		case MBC2:
-			WriteGBRomByte(addr,bank & 0x1F);
-			break;
-		case MBC5:
-			WriteGBRomByte(addr,bank & 0xFF);
-			WriteGBRomByte(addr2,bank >> 8);
-			break;
-		default:
-		case MBC3:
-			WriteGBRomByte(addr,bank);
-			break;
+		if(ReadGBRomByte(_ADDR_LOGO+i) != logo[i])
+			ret = 0;
 	}
+	WriteGBRomByte(0x4000,0x00);
+	WriteGBRomByte(0x6000,0x00);
+	return ret;
+}
+void _MBC1OpenRam(void)
+{
+	//set banking mode to RAM
+	WriteGBRomByte(0x6000,0x01);
+	_EnableRam();
+}
+void _MBC1CloseRam(void)
+{
+	WriteGBRomByte(0x6000,0x00);
+	_DisableRam();
+}
+void _MBC2SwitchROMBank(uint16_t bank)
+{
+	//the MBC2 registers are selected by A8, which has to be set for the rom bank
+	WriteGBRomByte(0x2100,bank & 0x1F);
+}
+void _MBC2OpenRam(void)
+{
+	//the ghost read fix from https://www.insidegadgets.com/2011/03/28/gbcartread-arduino-based-gameboy-cart-reader-%E2%80%93-part-2-read-the-ram/
+	//he said it otherwise had issues with MBC2? :/
+	ReadGBRomByte(0x0134);
+	_EnableRam();
+}
+//MBC3, MBC4, HuC3 & the pocket camera
+void _MBC3SwitchROMBank(uint16_t bank)
+{
+	WriteGBRomByte(0x2100,bank);
+}
+void _MBC5SwitchROMBank(uint16_t bank)
+{
+	WriteGBRomByte(0x2100,bank & 0xFF);
+	
+	//only carts over 4MB use bit 8, so it is only written when it changes
+	if((bank >> 8) != _rom_bank_high)
+	{
+		_rom_bank_high = bank >> 8;
+		WriteGBRomByte(0x3000,_rom_bank_high);
+	}
+}
+void _HuC1SwitchROMBank(uint16_t bank)
+{
+	WriteGBRomByte(0x2000,bank & 0x3F);
+}
+//dump loop of carts without a mapper, which have all 32KB of rom mapped
+void _ReadFlatRom(uint32_t offset, uint32_t length, api_sink sink)
+{
+	while(length > 0)
+	{
+		uint16_t addr = offset & 0x7FFF;
+		uint16_t chunk = 0x8000 - addr;
+		if(chunk > length)
+			chunk = length;
+		ReadGBRomBlock(addr,chunk,sink);
+		offset += chunk;
+		length -= chunk;
+	}
+}
+//dump loop of the mappers with bank 0 at 0x0000 and every other bank in the switchable 0x4000 region
+void _ReadBankedRom(uint32_t offset, uint32_t length, api_sink sink)
+{
+	while(length > 0)
+	{
+		uint16_t bank = offset >> 14;
+		uint16_t addr = offset & 0x3FFF;
+		uint16_t chunk = 0x4000 - addr;
+		if(chunk > length)
+			chunk = length;
+		offset += chunk;
+		length -= chunk;
+		
+		if(bank > 0)
+			addr |= 0x4000;
+		if(bank > 0 && bank != _rom_bank)
+		{
+			SwitchROMBank(bank);
+			_rom_bank = bank;
+		}
+		ReadGBRomBlock(addr,chunk,sink);
+	}
+}
 
-	return;
+//dump loop of MBC1, which reads the banks it can't map at 0x4000 from 0x0000. see _MBC1SwitchROMBank
+void _MBC1ReadRom(uint32_t offset, uint32_t length, api_sink sink)
+{
+	uint8_t mask = (LoadedMBC.Type == MBC1M)?0x0F:0x1F;
+	while(length > 0)
+	{
+		uint16_t bank = offset >> 14;
+		uint16_t addr = offset & 0x3FFF;
+		uint16_t chunk = 0x4000 - addr;
+		if(chunk > length)
+			chunk = length;
+		offset += chunk;
+		length -= chunk;
+		
+		if(bank & mask)
+			addr |= 0x4000;
+		if(bank != _rom_bank)
+		{
+			SwitchROMBank(bank);
+			_rom_bank = bank;
+		}
+		ReadGBRomBlock(addr,chunk,sink);
+	}
 }
-inline void SwitchRAMBank(int8_t bank)
+
+//one entry per mapper. a new mapper is a new entry (and a case in GetMBCType)
+const gb_mbc _mbc_drivers[] PROGMEM = 
 {
-	WriteGBRomByte(0x4000,bank);	
-	return;
+	//carts we don't know are dumped like an MBC3, without touching the ram
+	{ MBC_UNSUPPORTED, 0, 0xFF, _MBC3SwitchROMBank, _NoRamBank, _NoRamControl, _NoRamControl, _ReadBankedRom },
+	{ MBC_NONE, 0, 0xFF, _NoRomBank, _NoRamBank, _NoRamControl, _NoRamControl, _ReadFlatRom },
+	{ MBC_ROM_RAM, MBC_FLAG_RAM, 0xFF, _NoRomBank, _NoRamBank, _NoRamControl, _NoRamControl, _ReadFlatRom },
+	{ MBC1, MBC_FLAG_RAM, 0xFF, _MBC1SwitchROMBank, _SwitchRamBank, _MBC1OpenRam, _MBC1CloseRam, _MBC1ReadRom },
+	{ MBC1M, MBC_FLAG_RAM, 0xFF, _MBC1SwitchROMBank, _SwitchRamBank, _MBC1OpenRam, _MBC1CloseRam, _MBC1ReadRom },
+	{ MBC2, MBC_FLAG_RAM, 0x0F, _MBC2SwitchROMBank, _NoRamBank, _MBC2OpenRam, _DisableRam, _ReadBankedRom },
+	{ MBC3, MBC_FLAG_RAM, 0xFF, _MBC3SwitchROMBank, _SwitchRamBank, _EnableRam, _DisableRam, _ReadBankedRom },
+	{ MBC3_TIMER, MBC_FLAG_RAM | MBC_FLAG_RTC, 0xFF, _MBC3SwitchROMBank, _SwitchRamBank, _EnableRam, _DisableRam, _ReadBankedRom },
+	{ MBC4, MBC_FLAG_RAM, 0xFF, _MBC3SwitchROMBank, _SwitchRamBank, _EnableRam, _DisableRam, _ReadBankedRom },
+	{ MBC5, MBC_FLAG_RAM, 0xFF, _MBC5SwitchROMBank, _SwitchRamBank, _EnableRam, _DisableRam, _ReadBankedRom },
+	//MMM01 & TAMA5 have no cart to test a driver with, so they keep being dumped like an MBC3
+	{ MBC_MMM01, MBC_FLAG_RAM, 0xFF, _MBC3SwitchROMBank, _SwitchRamBank, _EnableRam, _DisableRam, _ReadBankedRom },
+	{ MBC_HUC1, MBC_FLAG_RAM, 0xFF, _HuC1SwitchROMBank, _SwitchRamBank, _EnableRam, _DisableRam, _ReadBankedRom },
+	{ MBC_HUC3, MBC_FLAG_RAM, 0xFF, _MBC3SwitchROMBank, _SwitchRamBank, _EnableRam, _DisableRam, _ReadBankedRom },
+	{ MBC_CAMERA, MBC_FLAG_RAM, 0xFF, _MBC3SwitchROMBank, _SwitchRamBank, _EnableRam, _DisableRam, _ReadBankedRom },
+	{ MBC_TAMA5, MBC_FLAG_RAM, 0xFF, _MBC3SwitchROMBank, _SwitchRamBank, _EnableRam, _DisableRam, _ReadBankedRom },
+};
+//loads the driver of the mapper, so the rest of the code doesn't have to look at the type anymore
+void SelectMBC(uint8_t type)
+{
+	uint8_t index = 0;
+	for(uint8_t i = 0;i < sizeof(_mbc_drivers) / sizeof(gb_mbc);i++)
+	{
+		if(pgm_read_byte(&_mbc_drivers[i].Type) == type)
+			index = i;
+	}
+	memcpy_P(&LoadedMBC,&_mbc_drivers[index],sizeof(gb_mbc));
+	_rom_bank = 0xFFFF;
+	_rom_bank_high = 0xFF;
 }
 inline void SwitchFlashRAMBank(int8_t bank)
 {
@@ -272,8 +508,7 @@ int8_t GetGBInfo(char* GameName, uint8_t* romFlag , uint8_t* ramFlag,uint8_t* ca
 		return -1;
 	
 	//reset cart
-	ClearPin(CTRL_PORT,CS2);
-	SetPin(CTRL_PORT,CS2);
+	ResetGBCart();
 	
 	GBC_Header temp;
 	uint8_t header[0x51] = {0};
@@ -393,21 +628,26 @@ int8_t GetGBInfo(char* GameName, uint8_t* romFlag , uint8_t* ramFlag,uint8_t* ca
 	*cartFlag = temp.GBCFlag;
 	*romFlag = header[_CALC_ADDR(_ADDR_ROM_SIZE)];
 	*ramFlag = header[_CALC_ADDR(_ADDR_RAM_SIZE)];	
-	LoadedBankType = GetMBCType(temp.CartType);	
+	SelectMBC(GetMBCType(temp.CartType));
+	
+	//only a 1MB MBC1 can be a multicart
+	if(LoadedMBC.Type == MBC1 && *romFlag == 0x05 && _MBC1IsMulticart(&header[_CALC_ADDR(_ADDR_LOGO)]))
+		SelectMBC(MBC1M);
 	return 1;	
 }
 
 uint16_t GetAmountOfRomBacks(uint8_t RomSizeFlag)
 {
-	if(RomSizeFlag <= 7)
+	//0x00 (32KB) up to 0x08 (8MB)
+	if(RomSizeFlag <= 8)
 		return 2 << RomSizeFlag;
 	switch(RomSizeFlag)
 	{
-		case 52:
+		case 0x52:
 			return 72;
-		case 53:
+		case 0x53:
 			return 80;
-		case 54: 
+		case 0x54: 
 			return 96;
 		default:
 			return 1;
@@ -420,13 +660,13 @@ int8_t GetRamDetails(uint16_t *end_addr, uint8_t *banks,uint8_t RamSizeFlag)
 	
 	//every MBC type has RamSizeFlag as the amount of banks
 	//...except MBC2 which needs RamSizeFlag to be set to 0, because its RAM is included in MBC2
-	if(LoadedBankType != MBC2 && RamSizeFlag <= 0)
+	if(LoadedMBC.Type != MBC2 && RamSizeFlag <= 0)
 	{
 		//no ram, BAIL IT
 		return ERR_NO_INFO;
 	}
 	
-	if(LoadedBankType == MBC2)
+	if(LoadedMBC.Type == MBC2)
 	{		
 		//Set the Ram Size & end addr. MBC2 is euh...special :P
 		*banks = 1;
@@ -460,13 +700,55 @@ int8_t GetRamDetails(uint16_t *end_addr, uint8_t *banks,uint8_t RamSizeFlag)
 	}
 	return 1;
 }
+void ReadGBRtc(uint8_t* regs)
+{
+	//latch the clock, so it doesn't tick while we read it
+	WriteGBRomByte(0x6000,0x00);
+	WriteGBRomByte(0x6000,0x01);
+	
+	//the clock chip needs a few us between accesses
+	for(uint8_t i = 0;i < GB_RTC_REGISTERS;i++)
+	{
+		WriteGBRomByte(0x4000,0x08 + i);
+		_delay_us(4);
+		regs[i] = _Read8BitByte(CS1,0xA000);
+		_delay_us(4);
+	}
+}
+void WriteGBRtc(uint8_t* regs)
+{
+	//halt the clock while it is set. the day high register (with the halt bit as it was saved) is written last
+	WriteGBRomByte(0x4000,0x0C);
+	_delay_us(4);
+	_Write8BitByte(CS1,0xA000,regs[4] | 0x40);
+	_delay_us(4);
+	
+	for(uint8_t i = 0;i < GB_RTC_REGISTERS;i++)
+	{
+		WriteGBRomByte(0x4000,0x08 + i);
+		_delay_us(4);
+		_Write8BitByte(CS1,0xA000,regs[i]);
+		_delay_us(4);
+	}
+}
+//the registers & the latched registers both get what we latched. the timestamp is left to the host, we have no clock
+uint8_t GetGBRtcFooterByte(uint8_t* regs, uint8_t index)
+{
+	if(index >= GB_RTC_REGISTERS * 8 || (index & 0x03))
+		return 0;
+	return regs[(index >> 2) % GB_RTC_REGISTERS];
+}
+void SetGBRtcFooterByte(uint8_t* regs, uint8_t index, uint8_t data)
+{
+	if(index < GB_RTC_REGISTERS * 4 && !(index & 0x03))
+		regs[index >> 2] = data;
+}
 uint8_t GetMBCType(uint8_t CartType)
 {
 	uint8_t ret = MBC_NONE;
 	
 	switch(CartType)
 	{
-		case 0xFF: //HuC1 + RAM + BATTERY
 		case 0x01: //MBC1
 		case 0x02: //MBC1 + ROM
 		case 0x03: //MBC1 + ROM + BATTERY
@@ -480,14 +762,20 @@ uint8_t GetMBCType(uint8_t CartType)
 			
 		case 0x08: //ROM + RAM
 		case 0x09: //ROM + RAM + BATTERY
+			ret = MBC_ROM_RAM;
+			break;
+			
 		case 0x0B: //MMM01
 		case 0x0C: //MMM01 + RAM
 		case 0x0D: //MMM01 + RAM + BATTERY
-		case 0xFC: //POCKET CAMERA
-		case 0xFD: //BANDAI TAMA5
-		case 0xFE: //HuC3
+			ret = MBC_MMM01;
+			break;
+			
 		case 0x0F: //MBC3 + TIMER + BATTERY
 		case 0x10: //MBC3 + TIMER + RAM + BATTERY
+			ret = MBC3_TIMER;
+			break;
+			
 		case 0x11: //MBC3
 		case 0x12: //MBC3 + RAM
 		case 0x13: //MBC3 + RAM + BATTERY
@@ -508,6 +796,19 @@ uint8_t GetMBCType(uint8_t CartType)
 		case 0x1E: //MBC5 + RUMBLE + RAM + BATTERY
 			ret = MBC5;
 			break;
+			
+		case 0xFC: //POCKET CAMERA
+			ret = MBC_CAMERA;
+			break;
+		case 0xFD: //BANDAI TAMA5
+			ret = MBC_TAMA5;
+			break;
+		case 0xFE: //HuC3
+			ret = MBC_HUC3;
+			break;
+		case 0xFF: //HuC1 + RAM + BATTERY
+			ret = MBC_HUC1;
+			break;
 		
 		case 0x00:
 			ret = MBC_NONE;
@@ -77,10 +77,18 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define MBC_UNSUPPORTED 0x00
 #define MBC_NONE 0x09
 #define MBC1 0x10
+#define MBC1M 0x11
 #define MBC2 0x20
 #define MBC3 0x30
+#define MBC3_TIMER 0x31
 #define MBC4 0x40
 #define MBC5 0x50
+#define MBC_ROM_RAM 0x0A
+#define MBC_MMM01 0x60
+#define MBC_HUC1 0x70
+#define MBC_HUC3 0x80
+#define MBC_CAMERA 0x90
+#define MBC_TAMA5 0xA0
 
 typedef struct _GBC_Header
 {
@@ -100,13 +108,33 @@ typedef struct _GBC_Header
 	uint8_t GlobalChecksum[2]; // 0x14E - 0x14F
 } GBC_Header ;
 
-uint8_t LoadedBankType;
+//receives the bytes of a block read
+typedef void (*api_sink)(uint8_t data);
+
+//MBC driver. every mapper has an entry in a table, which is loaded once the header is read
+#define MBC_FLAG_RAM			0x01 //mapper can have ram & it is read/written through 0xA000
+#define MBC_FLAG_RTC			0x04 //MBC3 clock, saved after the ram
+typedef struct _gb_mbc
+{
+	uint8_t Type;
+	uint8_t Flags;
+	uint8_t RamMask; //bits of a ram byte that hold data
+	void (*SwitchROMBank)(uint16_t bank);
+	void (*SwitchRAMBank)(int8_t bank);
+	void (*OpenRam)(void);
+	void (*CloseRam)(void);
+	//dump loop : reads 'length' bytes starting at 'offset' of the rom & passes them to the sink
+	void (*ReadRom)(uint32_t offset, uint32_t length, api_sink sink);
+} gb_mbc;
+
+gb_mbc LoadedMBC;
 
 //-------------------------
 //general functions
 //-------------------------
 void Setup_Pins_8bitMode(void);
 void Set8BitAddress(uint16_t address);
+void Set8BitAddressLow(uint8_t address);
 
 //not sure if this is the most efficient way but... we pass which CS pin to use here
 #define ReadGBRomByte(x) _Read8BitByte(0,x)
@@ -114,6 +142,14 @@ void Set8BitAddress(uint16_t address);
 uint8_t ReadGBRamByte(uint16_t address);
 uint8_t _Read8BitByte(uint8_t CS_Pin, uint16_t address);
 
+//sequential reads, passing every byte to the sink
+#define ReadGBRomBlock(a,l,s) Read8BitBlock(0,a,l,s)
+#define ReadGBARamBlock(a,l,s) Read8BitBlock(CS2,a,l,s)
+void ReadGBRamBlock(uint16_t address, uint16_t length, api_sink sink);
+void Read8BitBlock(uint8_t CS_Pin, uint16_t address, uint16_t length, api_sink sink);
+void CalibrateGBBusTiming(void);
+
+
 #define WriteGBRomByte(a,d) _Write8BitByte(0,a,d);
 #define WriteGBARamByte(a,d) _Write8BitByte(CS2,a,d);
 int8_t WriteGBRamByte(uint16_t addr,uint8_t byte);
@@ -124,12 +160,24 @@ void _Write8BitByte(uint8_t CS_Pin, uint16_t addr,uint8_t byte);
 //-------------------------
 int8_t OpenGBRam(void);
 void CloseGBRam(void);
-void SwitchROMBank(int8_t bank);
-void SwitchRAMBank(int8_t bank);
+void ResetGBCart(void);
+void SelectMBC(uint8_t type);
+#define SwitchROMBank(x) LoadedMBC.SwitchROMBank(x)
+#define SwitchRAMBank(x) LoadedMBC.SwitchRAMBank(x)
+#define ReadGBRom(o,l,s) LoadedMBC.ReadRom(o,l,s)
 void SwitchFlashRAMBank(int8_t bank);
 int8_t GetGBInfo(char* GameName, uint8_t* romFlag , uint8_t* ramFlag,uint8_t* cartFlag);
 uint16_t GetAmountOfRomBacks(uint8_t RomSizeFlag);
 int8_t GetRamDetails(uint16_t *end_addr, uint8_t *banks,uint8_t RamSizeFlag);
+
+//MBC3 clock (registers 0x08 - 0x0C). the ram has to be open to access it.
+//in a save file it is the footer most emulators use : the 5 registers as 32 bit values, the same 5 latched & a 64 bit unix timestamp
+#define GB_RTC_REGISTERS 5
+#define GB_RTC_SIZE 48
+void ReadGBRtc(uint8_t* regs);
+void WriteGBRtc(uint8_t* regs);
+uint8_t GetGBRtcFooterByte(uint8_t* regs, uint8_t index);
+void SetGBRtcFooterByte(uint8_t* regs, uint8_t index, uint8_t data);
 uint8_t GetMBCType(uint8_t CartType);
 
 
@@ -17,9 +17,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <avr/sleep.h>
 #include <avr/interrupt.h>
 #include <avr/wdt.h>
+#include <avr/pgmspace.h>
 #include <util/delay.h>
 #include <string.h>
-#include <ctype.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -33,10 +33,18 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "24bit_cart.h"
 
 
+//received command frame : opcode, parameter length, parameters & checksum
 uint8_t cmd_size = 0;
-#define MAX_CMD_SIZE 0x20
-char cmd[MAX_CMD_SIZE+1] = {0};
+#define MAX_CMD_SIZE (API_CMD_MAX_PARAMS + 3)
+uint8_t cmd[MAX_CMD_SIZE] = {0};
 uint8_t process_cmd = 0;
+//the handshake is send from the main loop, sending it from the serial interrupt would block the receiving
+volatile uint8_t send_handshake = 0;
+
+//a command frame has to arrive in one go. timer 0 overflows every 256*1024 cycles (~16ms at 16Mhz) and after
+//CMD_TIMEOUT_TICKS of them without a byte, a partial frame is dropped so it can't swallow the next command or handshake
+#define CMD_TIMEOUT_TICKS 4
+volatile uint8_t cmd_idle = 0;
 
 #ifdef GPIO_EXTENDER_MODE
 	#define ACTIVE_LED PD7
@@ -89,28 +97,76 @@ uint8_t inline SenseGbaMode(void)
 #endif
 }
 
+//reads the next (big endian) parameter of size bytes from the command. parameters the host left out are 0
+uint32_t GetCommandParameter(uint8_t** param,uint8_t* length,uint8_t size)
+{
+	uint32_t value = 0;
+	for(;size > 0 && *length > 0;size--,(*length)--)
+	{
+		value = (value << 8) | **param;
+		(*param)++;
+	}
+	return value;
+}
+
+//command handlers, called with the parameters of the command frame
+typedef int8_t (*api_command)(uint8_t* params,uint8_t length);
+int8_t Command_ReadMemory(ROM_TYPE type,uint8_t* params,uint8_t length)
+{
+	uint8_t mode = GetCommandParameter(&params,&length,1);
+	uint32_t offset = GetCommandParameter(&params,&length,4);
+	uint32_t size = GetCommandParameter(&params,&length,4);
+	return API_Get_Memory(type,SenseGbaMode(),mode,offset,size);
+}
+int8_t Command_ReadRom(uint8_t* params,uint8_t length)
+{
+	return Command_ReadMemory(TYPE_ROM,params,length);
+}
+int8_t Command_ReadRam(uint8_t* params,uint8_t length)
+{
+	return Command_ReadMemory(TYPE_RAM,params,length);
+}
+int8_t Command_WriteRam(uint8_t* params,uint8_t length)
+{
+	return API_WriteRam(SenseGbaMode(),GetCommandParameter(&params,&length,1));
+}
+int8_t Command_SetBaudRate(uint8_t* params,uint8_t length)
+{
+	return API_SetBaudRate(GetCommandParameter(&params,&length,4));
+}
+int8_t Command_GetInfo(uint8_t* params,uint8_t length)
+{
+	return API_GetInfo(SenseGbaMode());
+}
+//jump table, indexed by opcode - API_CMD_READ_ROM
+const api_command commands[API_CMD_COUNT] PROGMEM = 
+{
+	Command_ReadRom,
+	Command_ReadRam,
+	Command_WriteRam,
+	Command_SetBaudRate,
+	Command_GetInfo
+};
+
 void ProcessCommand(void)
 {
 	DisableSerialInterrupt();
-	process_cmd = 0;
 	int8_t ret = 0;
 	SetActive();
 	
-	if(strncmp(cmd,API_READ_ROM,API_READ_ROM_SIZE) == 0 || strncmp(cmd,API_READ_RAM,API_READ_RAM_SIZE) == 0 )
+	uint8_t checksum = 0;
+	for(uint8_t i = 0;i < cmd_size;i++)
+		checksum ^= cmd[i];
+	
+	if(checksum != 0)
 	{
-		ROM_TYPE type = (strncmp(cmd,API_READ_ROM,API_READ_ROM_SIZE) == 0)?TYPE_ROM:TYPE_RAM;
-		ret = API_Get_Memory(type,SenseGbaMode());
-	}
-	else if(strncmp(cmd,API_WRITE_RAM,API_WRITE_RAM_SIZE) == 0)
-	{			
-		ret = API_WriteRam(SenseGbaMode());	
+		API_Send_Abort(API_ABORT);
+		cprintf("COMMAND CHECKSUM FAILED\r\n");
 	}
 	else
 	{
-		API_Send_Abort(API_ABORT);
-		cprintf("COMMAND '");
-		cprintf(cmd);
-		cprintf("' UNKNOWN\r\n");
+		api_command command = (api_command)pgm_read_word(&commands[cmd[0] - API_CMD_READ_ROM]);
+		ret = command(&cmd[2],cmd[1]);
 	}
 	
 	//process errors
@@ -119,13 +175,13 @@ void ProcessCommand(void)
 		switch(ret)
 		{
 			case ERR_PACKET_FAILURE:
-				cprintf("PCKT_FAILURE");
+				cprintf("PCKT_FAILURE\r\n");
 				break;
 			case ERR_NOK_RETURNED:
-				cprintf("NOK_RET");
+				cprintf("NOK_RET\r\n");
 				break;
 			case ERR_NO_SAVE:
-				cprintf("NO_SAV");
+				cprintf("NO_SAV\r\n");
 				break;
 			case ERR_LOGO_CHECK:
 				cprintf("LOGO_CHECK\r\n");
@@ -133,6 +189,12 @@ void ProcessCommand(void)
 			case ERR_FAULT_CART:
 				cprintf("FAULT_CART\r\n");
 				break;
+			case ERR_INVALID_PARAM:
+				cprintf("INVALID_PARAM\r\n");
+				break;
+			case ERR_TIMEOUT:
+				cprintf("TIMEOUT\r\n");
+				break;
 			default :
 				cprintf("ERR_UNKNOWN :'");
 				cprintf_char(ret);
@@ -144,32 +206,47 @@ void ProcessCommand(void)
 end_function:
 	cmd_size = 0;
 	memset(cmd,0,MAX_CMD_SIZE);
+	process_cmd = 0;
 	SetInactive();
 	EnableSerialInterrupt();
 	return;
 }
 void ProcessChar(char byte)
 {
-	if(byte == API_HANDSHAKE_REQUEST)
-	{
-		cprintf_char(API_HANDSHAKE_ACCEPT);
-		//auto detect byte
-		cprintf_char(SenseAutoDetectEnabled());
+	//data for a running block write?
+	if(API_BufferByte(byte))
 		return;
-	}
-	else if(byte == API_ABORT_CMD)
+	
+	//still busy with the previous command
+	if(process_cmd)
 		return;
-	else if(byte == '\n' || byte == '\r')
+	
+	if(cmd_size == 0)
 	{
-		//set variable instead of processing command. something in the lines of disabling interrupt while in one that just doesn't work out nicely			
-		process_cmd = cmd_size > 0;
+		if(byte == API_HANDSHAKE_REQUEST)
+		{
+			send_handshake = 1;
+			return;
+		}
+		
+		//anything that isn't an opcode (like API_ABORT_CMD) is ignored
+		if((uint8_t)byte < API_CMD_READ_ROM || (uint8_t)byte >= API_CMD_READ_ROM + API_CMD_COUNT)
+			return;
 	}
-	else if( cmd_size < MAX_CMD_SIZE )
+	else if(cmd_size == 1 && (uint8_t)byte > API_CMD_MAX_PARAMS)
 	{
-		//space left!
-		cmd[cmd_size] = byte;
-		cmd_size++;
+		//not a command frame after all
+		cmd_size = 0;
+		return;
 	}
+	
+	cmd[cmd_size] = byte;
+	cmd_size++;
+	cmd_idle = 0;
+	
+	//set variable instead of processing command. something in the lines of disabling interrupt while in one that just doesn't work out nicely
+	if(cmd_size >= 3 && cmd_size == cmd[1] + 3)
+		process_cmd = 1;
 	return;
 }
 int main(void)
@@ -186,6 +263,9 @@ int main(void)
 	//set it so that incoming msg's are ignored.
 	setSerialRecvCallback(ProcessChar);
 	
+	//timer 0 free running at F_CPU/1024, polled for the command timeout
+	TCCR0 = _BV(CS02) | _BV(CS00);
+	
 /*#ifdef __AVR_ATmega8__
 	cprintf("Atmega8 says : ");
 #elif defined(__AVR_ATmega32__)
@@ -199,10 +279,28 @@ int main(void)
 	uint16_t addr = 0x0000;//0x00000050;//0xFF31;//0x13FF;//0x104;//0x200;//0x8421;
     while(1) 
 	{
+		if(send_handshake)
+		{
+			send_handshake = 0;
+			API_Send_Handshake(SenseAutoDetectEnabled());
+		}
 		if(process_cmd)
 		{
 			ProcessCommand();
 		}
+		if(TIFR & _BV(TOV0))
+		{
+			TIFR = _BV(TOV0);
+			//the serial interrupt fills the frame, so it can't run while we drop it
+			uint8_t sreg = SREG;
+			cli();
+			if(cmd_size > 0 && !process_cmd && ++cmd_idle >= CMD_TIMEOUT_TICKS)
+			{
+				cmd_size = 0;
+				cmd_idle = 0;
+			}
+			SREG = sreg;
+		}
 		if(CheckControlPin(BTN) == LOW)
 		{
 			cprintf("Btn pressed!\r\n");			
@@ -0,0 +1,95 @@
+/*
+gbbench - runs the GB/C/A dumper firmware in simavr to count cycles. the cart side of the bus
+Copyright (C) 2018-2019  DacoTaco
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation version 2.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+//this file is build in SIM_MODE against the sim's avr/io.h, so the cart model of sim_cart.c can be used as is.
+//the registers it looks at are plain variables here, which mirror whatever the firmware in simavr puts on the bus.
+#include <inttypes.h>
+#include <string.h>
+#include <avr/io.h>
+#include "gb_pins.h"
+#include "sim_io.h"
+#include "sim_cart.h"
+#include "bench_bus.h"
+
+volatile uint8_t PORTA,PORTB,PORTC,PORTD;
+volatile uint8_t DDRA,DDRB,DDRC,DDRD;
+
+sim_counters sim_count;
+
+volatile uint8_t* sim_DdrOf(volatile uint8_t* port)
+{
+	if(port == &PORTA)
+		return &DDRA;
+	if(port == &PORTB)
+		return &DDRB;
+	if(port == &PORTC)
+		return &DDRC;
+	return &DDRD;
+}
+volatile uint8_t* _LinePort(uint8_t line)
+{
+	switch(line)
+	{
+		case BENCH_LINE_DATA:
+			return &DATA_PORT;
+		case BENCH_LINE_ADDR1:
+			return &ADDR_PORT1;
+		default:
+			return &ADDR_PORT2;
+	}
+}
+
+void bench_BusReset(void)
+{
+	//all control lines are inactive (high) when the firmware starts
+	CTRL_DDR = 0xFF;
+	CTRL_PORT = 0xFF;
+	memset(&sim_count,0,sizeof(sim_count));
+}
+void bench_BusUpdate(const bench_bus* bus)
+{
+	for(uint8_t i = 0;i < BENCH_LINES;i++)
+	{
+		*_LinePort(i) = bus->port[i];
+		*sim_DdrOf(_LinePort(i)) = bus->ddr[i];
+	}
+	
+	uint8_t ctrl = 0xFF;
+	if(!bus->rd)
+		ctrl &= ~_BV(RD);
+	if(!bus->wd)
+		ctrl &= ~_BV(WD);
+	if(!bus->cs1)
+		ctrl &= ~_BV(CS1);
+	if(!bus->cs2)
+		ctrl &= ~_BV(CS2);
+	
+	uint8_t old = CTRL_PORT;
+	CTRL_PORT = ctrl;
+	if(old != ctrl)
+		sim_CartControl(old,ctrl);
+}
+uint8_t bench_BusDrive(uint8_t line, uint8_t* value)
+{
+	return sim_CartDrive(_LinePort(line),value);
+}
+uint64_t bench_RdStrobes(void)
+{
+	return sim_count.rd_strobes;
+}
+uint64_t bench_Contentions(void)
+{
+	return sim_count.contentions;
+}
@@ -0,0 +1,44 @@
+/*
+gbbench - runs the GB/C/A dumper firmware in simavr to count cycles. the cart side of the bus
+Copyright (C) 2018-2019  DacoTaco
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation version 2.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef _BENCH_BUS_H_
+#define _BENCH_BUS_H_
+
+#include <stdint.h>
+
+//the 3 bytes of the cart bus. on GBA the data lines are A16-A23 & the address lines are AD0-AD15
+#define BENCH_LINE_DATA 0
+#define BENCH_LINE_ADDR1 1
+#define BENCH_LINE_ADDR2 2
+#define BENCH_LINES 3
+
+//what the dumper puts on the cart bus, no matter if it comes from the AVR's ports or from the expanders
+typedef struct _bench_bus
+{
+	uint8_t port[BENCH_LINES];
+	uint8_t ddr[BENCH_LINES];
+	uint8_t rd;
+	uint8_t wd;
+	uint8_t cs1;
+	uint8_t cs2;
+} bench_bus;
+
+void bench_BusReset(void);
+void bench_BusUpdate(const bench_bus* bus);
+uint8_t bench_BusDrive(uint8_t line, uint8_t* value);
+uint64_t bench_RdStrobes(void);
+uint64_t bench_Contentions(void);
+
+#endif
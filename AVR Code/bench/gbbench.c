@@ -0,0 +1,1107 @@
+/*
+gbbench - runs the GB/C/A dumper firmware in simavr to count cycles
+Copyright (C) 2018-2019  DacoTaco
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation version 2.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+//the real firmware (the elf the Makefile builds) runs in simavr, with the cart model of the sim on the bus
+//and this file playing the host on the other end of the USART. every command is timed in AVR cycles.
+//timestamps are taken when the host hands a byte to the USART, and when the AVR writes one to UDR.
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim_avr.h"
+#include "sim_io.h"
+#include "sim_elf.h"
+#include "avr_ioport.h"
+#include "avr_uart.h"
+#include "avr_spi.h"
+#include "gbc_api.h"
+#include "../sim/sim_cart.h"
+#include "bench_bus.h"
+
+//how the dumper is wired up, per build. keep in sync with gb_pins.h & GBC_Dumper.c
+typedef struct _bench_wiring
+{
+	const char* mcu;
+	uint8_t build;
+	const char* name;
+	//the cart bus is behind 3 MCP23S08's on the SPI bus, in the order of the BENCH_LINE_*'s
+	uint8_t expander;
+	char line_port[BENCH_LINES];
+	char ctrl_port;
+	uint8_t rd;
+	uint8_t wd;
+	uint8_t cs1;
+	uint8_t cs2;
+	uint8_t btn;
+	//pulled low for GBA carts
+	uint8_t sense;
+	char expander_cs_port;
+	uint8_t expander_cs;
+} bench_wiring;
+
+const bench_wiring wirings[] =
+{
+	{ "atmega32", API_BUILD_NORMAL, "normal", 0, { 'A', 'B', 'C' }, 'D', 4, 3, 5, 6, 7, 2, 0, 0 },
+	{ "atmega8", API_BUILD_GPIO_EXTENDER, "gpio extender", 1, { 0, 0, 0 }, 'C', 3, 2, 4, 5, 1, 0, 'B', 2 },
+};
+
+//MCP23S08
+#define EXP_IODIR 0x00
+#define EXP_IPOL 0x01
+#define EXP_IOCON 0x05
+#define EXP_GPPU 0x06
+#define EXP_GPIO 0x09
+#define EXP_OLAT 0x0A
+#define EXP_REGS 0x0B
+#define EXP_IOCON_SEQOP 0x20
+#define EXP_IOCON_HAEN 0x08
+
+typedef struct _bench_expander
+{
+	uint8_t regs[EXP_REGS];
+} bench_expander;
+
+//the bus line behind each hardware address (ADDR_CHIP_1, ADDR_CHIP_2 & DATA_CHIP_1)
+const uint8_t expander_lines[BENCH_LINES] = { BENCH_LINE_ADDR1, BENCH_LINE_ADDR2, BENCH_LINE_DATA };
+
+//the state of the simulation
+avr_t* avr = NULL;
+elf_firmware_t firmware;
+const bench_wiring* wiring = NULL;
+avr_irq_t* uart_input = NULL;
+avr_irq_t* spi_input = NULL;
+uint8_t gba_inserted = 0;
+uint8_t bus_updating = 0;
+
+bench_expander expanders[BENCH_LINES];
+uint8_t exp_selected = 0;
+uint8_t exp_count = 0;
+uint8_t exp_opcode = 0;
+uint8_t exp_reg = 0;
+uint64_t exp_spi_bytes = 0;
+
+//host side of the USART
+uint32_t host_baud = 1000000;
+uint8_t* host_rx = NULL;
+uint64_t* host_rx_cycle = NULL;
+uint32_t host_rx_count = 0;
+uint32_t host_rx_size = 0;
+uint8_t host_tx[0x200];
+uint16_t host_tx_count = 0;
+uint16_t host_tx_pos = 0;
+uint64_t host_tx_next = 0;
+uint64_t host_tx_cycle = 0;
+
+//results
+typedef struct _bench_metric
+{
+	char name[64];
+	double value;
+} bench_metric;
+
+#define MAX_METRICS 256
+bench_metric metrics[MAX_METRICS];
+uint16_t metric_count = 0;
+uint32_t failures = 0;
+
+typedef struct _bench_transfer
+{
+	uint64_t ttfb; //last command byte send -> first reply byte
+	uint64_t start; //our API_OK -> first data byte
+	uint64_t cycles; //first -> last data byte
+	uint32_t bytes;
+	uint32_t errors;
+	uint64_t rd_strobes;
+	uint64_t spi_bytes; //bytes clocked to a selected expander
+} bench_transfer;
+
+void bench_Metric(const char* name, double value)
+{
+	if(metric_count >= MAX_METRICS)
+		return;
+	snprintf(metrics[metric_count].name,sizeof(metrics[metric_count].name),"%s",name);
+	metrics[metric_count].value = value;
+	metric_count++;
+}
+void bench_Fail(const char* test, const char* reason)
+{
+	printf("\t%s : FAILED (%s)\n",test,reason);
+	failures++;
+}
+
+//AVR ports & the cart
+//--------------------------------
+avr_ioport_state_t _PortState(char name)
+{
+	avr_ioport_state_t state;
+	memset(&state,0,sizeof(state));
+	avr_ioctl(avr,AVR_IOCTL_IOPORT_GETSTATE(name),&state);
+	return state;
+}
+//puts value on the input pins in mask. the other input pins read their pull up
+void _DrivePort(char name, uint8_t mask, uint8_t value)
+{
+	avr_ioport_state_t state = _PortState(name);
+	uint8_t inputs = ~state.ddr;
+	uint8_t pins = (state.port & state.ddr) | (value & mask & inputs) | (state.port & ~mask & inputs);
+	if(pins == state.pin)
+		return;
+	avr_raise_irq(avr_io_getirq(avr,AVR_IOCTL_IOPORT_GETIRQ(name),IOPORT_IRQ_PIN_ALL),pins);
+}
+uint8_t _ExpanderPins(uint8_t chip)
+{
+	bench_expander* exp = &expanders[chip];
+	uint8_t inputs = exp->regs[EXP_IODIR];
+	uint8_t value = exp->regs[EXP_GPPU];
+	bench_BusDrive(expander_lines[chip],&value);
+	return (exp->regs[EXP_OLAT] & ~inputs) | ((value ^ exp->regs[EXP_IPOL]) & inputs);
+}
+//called whenever the firmware changes a port or an expander. hands the new bus state to the cart & puts its answer on the pins
+void bench_UpdateBus(void)
+{
+	if(bus_updating)
+		return;
+	bus_updating = 1;
+
+	bench_bus bus;
+	avr_ioport_state_t ctrl = _PortState(wiring->ctrl_port);
+	//lines the AVR doesn't drive are pulled up on the cart
+	uint8_t level = ctrl.port | ~ctrl.ddr;
+	bus.rd = (level >> wiring->rd) & 1;
+	bus.wd = (level >> wiring->wd) & 1;
+	bus.cs1 = (level >> wiring->cs1) & 1;
+	bus.cs2 = (level >> wiring->cs2) & 1;
+	for(uint8_t i = 0;i < BENCH_LINES;i++)
+	{
+		if(wiring->expander)
+		{
+			bus.port[expander_lines[i]] = expanders[i].regs[EXP_OLAT];
+			bus.ddr[expander_lines[i]] = ~expanders[i].regs[EXP_IODIR];
+		}
+		else
+		{
+			avr_ioport_state_t state = _PortState(wiring->line_port[i]);
+			bus.port[i] = state.port;
+			bus.ddr[i] = state.ddr;
+		}
+	}
+	bench_BusUpdate(&bus);
+
+	//the expanders are asked for their pins when they are read
+	if(!wiring->expander)
+	{
+		for(uint8_t i = 0;i < BENCH_LINES;i++)
+		{
+			uint8_t value = 0;
+			if(bench_BusDrive(i,&value))
+				_DrivePort(wiring->line_port[i],0xFF,value);
+			else
+				_DrivePort(wiring->line_port[i],0x00,0);
+		}
+	}
+
+	//the button is never pressed & the sense pin tells the firmware what is inserted
+	uint8_t mask = (1 << wiring->btn) | (1 << wiring->sense);
+	_DrivePort(wiring->ctrl_port,mask,gba_inserted?(1 << wiring->btn):mask);
+	bus_updating = 0;
+}
+void _PortChanged(struct avr_irq_t* irq, uint32_t value, void* param)
+{
+	char name = (char)(uintptr_t)param;
+	if(wiring->expander && name == wiring->expander_cs_port)
+	{
+		uint8_t selected = (_PortState(name).port & (1 << wiring->expander_cs)) == 0;
+		if(selected && !exp_selected)
+			exp_count = 0;
+		exp_selected = selected;
+	}
+	bench_UpdateBus();
+}
+
+//MCP23S08's, all on the same chip select. they only listen to their hardware address once IOCON.HAEN is set
+uint8_t _ExpanderAddressed(uint8_t chip)
+{
+	uint8_t address = (exp_opcode >> 1) & 0x07;
+	if(expanders[chip].regs[EXP_IOCON] & EXP_IOCON_HAEN)
+		return address == chip;
+	return address == 0;
+}
+void _SpiByte(struct avr_irq_t* irq, uint32_t value, void* param)
+{
+	uint8_t reply = 0xFF;
+	if(!exp_selected)
+	{
+		avr_raise_irq(spi_input,reply);
+		return;
+	}
+
+	exp_spi_bytes++;
+	if(exp_count == 0)
+		exp_opcode = value;
+	else if(exp_count == 1)
+		exp_reg = value % EXP_REGS;
+	else
+	{
+		uint8_t changed = 0;
+		uint8_t sequential = 1;
+		for(uint8_t chip = 0;chip < BENCH_LINES;chip++)
+		{
+			if(!_ExpanderAddressed(chip))
+				continue;
+
+			bench_expander* exp = &expanders[chip];
+			sequential = (exp->regs[EXP_IOCON] & EXP_IOCON_SEQOP) == 0;
+			if(exp_opcode & 0x01)
+				reply = (exp_reg == EXP_GPIO)?_ExpanderPins(chip):exp->regs[exp_reg];
+			else
+			{
+				uint8_t reg = (exp_reg == EXP_GPIO)?EXP_OLAT:exp_reg;
+				changed |= exp->regs[reg] != (uint8_t)value;
+				exp->regs[reg] = value;
+			}
+		}
+
+		//byte mode keeps the address pointer on the same register
+		if(sequential)
+			exp_reg = (exp_reg + 1) % EXP_REGS;
+		if(changed)
+			bench_UpdateBus();
+	}
+
+	if(exp_count < 2)
+		exp_count++;
+	avr_raise_irq(spi_input,reply);
+}
+
+//host
+//--------------------------------
+void _UartByte(struct avr_irq_t* irq, uint32_t value, void* param)
+{
+	if(host_rx_count >= host_rx_size)
+	{
+		host_rx_size = host_rx_size?host_rx_size * 2:0x10000;
+		host_rx = realloc(host_rx,host_rx_size);
+		host_rx_cycle = realloc(host_rx_cycle,host_rx_size * sizeof(uint64_t));
+		if(host_rx == NULL || host_rx_cycle == NULL)
+		{
+			printf("out of memory\n");
+			exit(1);
+		}
+	}
+	host_rx[host_rx_count] = value;
+	host_rx_cycle[host_rx_count] = avr->cycle;
+	host_rx_count++;
+}
+//start, 8 data bits & stop
+uint64_t _ByteCycles(void)
+{
+	return ((uint64_t)avr->frequency * 10) / host_baud;
+}
+uint64_t _Cycles(double seconds)
+{
+	return (uint64_t)(avr->frequency * seconds);
+}
+//runs one instruction, and shifts the next host byte in when the line is free
+int8_t bench_Step(void)
+{
+	if(host_tx_pos < host_tx_count && avr->cycle >= host_tx_next)
+	{
+		host_tx_cycle = avr->cycle;
+		host_tx_next = avr->cycle + _ByteCycles();
+		avr_raise_irq(uart_input,host_tx[host_tx_pos++]);
+		if(host_tx_pos >= host_tx_count)
+			host_tx_pos = host_tx_count = 0;
+	}
+
+	int state = avr_run(avr);
+	return (state == cpu_Done || state == cpu_Crashed)? -1 : 1;
+}
+int8_t bench_RunFor(uint64_t cycles)
+{
+	uint64_t end = avr->cycle + cycles;
+	while(avr->cycle < end)
+	{
+		if(bench_Step() < 0)
+			return -1;
+	}
+	return 1;
+}
+//runs till the host received count bytes (since the last reset)
+int8_t bench_WaitRx(uint32_t count, double timeout)
+{
+	uint64_t end = avr->cycle + _Cycles(timeout);
+	while(host_rx_count < count)
+	{
+		if(avr->cycle >= end || bench_Step() < 0)
+			return -1;
+	}
+	return 1;
+}
+void bench_Send(const uint8_t* data, uint16_t length)
+{
+	for(uint16_t i = 0;i < length && host_tx_count < sizeof(host_tx);i++)
+		host_tx[host_tx_count++] = data[i];
+}
+void bench_SendByte(uint8_t data)
+{
+	bench_Send(&data,1);
+}
+int8_t bench_Flush(void)
+{
+	uint64_t end = avr->cycle + _Cycles(1);
+	while(host_tx_count > 0)
+	{
+		if(avr->cycle >= end || bench_Step() < 0)
+			return -1;
+	}
+	return 1;
+}
+void bench_ResetRx(void)
+{
+	host_rx_count = 0;
+}
+//opcode, parameter length, parameters & checksum
+int8_t bench_SendCommand(uint8_t opcode, const uint8_t* params, uint8_t length)
+{
+	uint8_t frame[API_CMD_MAX_PARAMS + 3];
+	uint8_t checksum = opcode ^ length;
+	frame[0] = opcode;
+	frame[1] = length;
+	for(uint8_t i = 0;i < length;i++)
+	{
+		frame[2 + i] = params[i];
+		checksum ^= params[i];
+	}
+	frame[2 + length] = checksum;
+
+	bench_ResetRx();
+	bench_Send(frame,length + 3);
+	return bench_Flush();
+}
+uint8_t _PutParameter(uint8_t* params, uint32_t value, uint8_t size)
+{
+	for(uint8_t i = 0;i < size;i++)
+		params[i] = (value >> ((size - 1 - i) * 8)) & 0xFF;
+	return size;
+}
+
+//commands
+//--------------------------------
+int8_t bench_Handshake(uint32_t* f_cpu, uint8_t* build)
+{
+	bench_ResetRx();
+	bench_SendByte(API_HANDSHAKE_REQUEST);
+	if(bench_Flush() < 0 || bench_WaitRx(4,0.5) < 0 || host_rx[0] != API_HANDSHAKE_ACCEPT)
+		return -1;
+	if(bench_WaitRx(4 + host_rx[3],0.5) < 0 || host_rx[3] < 7)
+		return -1;
+
+	*build = host_rx[4];
+	*f_cpu = ((uint32_t)host_rx[7] << 24) | ((uint32_t)host_rx[8] << 16) | ((uint32_t)host_rx[9] << 8) | host_rx[10];
+	return 1;
+}
+//returns 1 if the AVR switched, 0 if it doesn't support the rate
+int8_t bench_SetBaud(uint32_t baud)
+{
+	uint8_t params[4];
+	uint64_t old_byte = _ByteCycles();
+	if(bench_SendCommand(API_CMD_SET_BAUD,params,_PutParameter(params,baud,4)) < 0 || bench_WaitRx(1,0.5) < 0)
+		return -1;
+	if(host_rx[0] != API_OK)
+		return 0;
+
+	//the AVR switches once our OK is out, give it a moment before probing
+	if(bench_RunFor(old_byte * 3) < 0)
+		return -1;
+	host_baud = baud;
+	bench_ResetRx();
+	bench_SendByte(API_HANDSHAKE_REQUEST);
+	if(bench_Flush() < 0 || bench_WaitRx(1,0.5) < 0 || host_rx[0] != API_HANDSHAKE_ACCEPT)
+		return -1;
+	return 1;
+}
+//reads the header of the read commands & gives the OK. returns the index of the first data byte
+int32_t _ReadHeader(uint32_t* size)
+{
+	if(bench_WaitRx(3,5) < 0 || host_rx[0] != API_GB_CART_TYPE_START)
+		return -1;
+	if(bench_WaitRx(6,1) < 0 || host_rx[3] != API_GAMENAME_START)
+		return -1;
+	uint32_t index = 6 + host_rx[4];
+	if(bench_WaitRx(index + 7,1) < 0 || host_rx[index] != API_FILESIZE_START || host_rx[index + 6] != API_OK)
+		return -1;
+
+	*size = ((uint32_t)host_rx[index + 1] << 24) | ((uint32_t)host_rx[index + 2] << 16) | ((uint32_t)host_rx[index + 3] << 8) | host_rx[index + 4];
+	bench_SendByte(API_OK);
+	if(bench_Flush() < 0)
+		return -1;
+	return index + 7;
+}
+uint16_t _Crc16(uint16_t crc, uint8_t data)
+{
+	crc ^= (uint16_t)data << 8;
+	for(uint8_t i = 0;i < 8;i++)
+		crc = (crc & 0x8000)?(crc << 1) ^ 0x1021:crc << 1;
+	return crc;
+}
+//reads (part of) the rom or ram & checks it against the cart. mode is API_TRANSFER_RAW or API_TRANSFER_BLOCK
+int8_t bench_Read(ROM_TYPE type, uint8_t mode, uint32_t offset, uint32_t length, bench_transfer* result)
+{
+	uint8_t params[9];
+	uint8_t size = 0;
+	size += _PutParameter(&params[size],mode,1);
+	size += _PutParameter(&params[size],offset,4);
+	size += _PutParameter(&params[size],length,4);
+
+	memset(result,0,sizeof(bench_transfer));
+	if(bench_SendCommand(type == TYPE_RAM?API_CMD_READ_RAM:API_CMD_READ_ROM,params,size) < 0)
+		return -1;
+	uint64_t send = host_tx_cycle;
+	if(bench_WaitRx(1,5) < 0)
+		return -1;
+	result->ttfb = host_rx_cycle[0] - send;
+
+	uint32_t full_size = 0;
+	int32_t index = _ReadHeader(&full_size);
+	if(index < 0)
+		return -1;
+	uint64_t ok = host_tx_cycle;
+	uint64_t strobes = bench_RdStrobes();
+	uint64_t spi_bytes = exp_spi_bytes;
+	if(length == 0 || length > full_size - offset)
+		length = full_size - offset;
+
+	uint32_t memory_size = 0;
+	const uint8_t* memory = (type == TYPE_RAM)?sim_GetSave(&memory_size):sim_GetRom(&memory_size);
+	//the line or 200us per byte, whatever is slower
+	double timeout = 2 + length * (20.0 / host_baud + 0.0002);
+	uint32_t first = index;
+	uint32_t last = index;
+
+	if(mode == API_TRANSFER_RAW)
+	{
+		if(bench_WaitRx(index + length,timeout) < 0)
+			return -1;
+		for(uint32_t i = 0;i < length;i++)
+		{
+			if(host_rx[index + i] != memory[(offset + i) % memory_size])
+				result->errors++;
+		}
+		last = index + length - 1;
+	}
+	else
+	{
+		//frames of API_BLOCK_SIZE, closed by API_BLOCK_END & the size
+		for(uint32_t block = 0;;block++)
+		{
+			if(bench_WaitRx(index + 1,timeout) < 0)
+				return -1;
+			if(host_rx[index] == API_BLOCK_END)
+			{
+				if(bench_WaitRx(index + 5,1) < 0)
+					return -1;
+				last = index + 4;
+				bench_SendByte(API_OK);
+				if(bench_Flush() < 0)
+					return -1;
+				break;
+			}
+
+			uint32_t data_offset = block * API_BLOCK_SIZE;
+			uint32_t block_length = (length - data_offset < API_BLOCK_SIZE)?length - data_offset:API_BLOCK_SIZE;
+			if(host_rx[index] != API_BLOCK_START || data_offset >= length || bench_WaitRx(index + 5 + block_length,timeout) < 0)
+				return -1;
+
+			uint16_t crc = 0;
+			for(uint32_t i = 0;i < block_length;i++)
+			{
+				uint8_t data = host_rx[index + 3 + i];
+				crc = _Crc16(crc,data);
+				if(data != memory[(offset + data_offset + i) % memory_size])
+					result->errors++;
+			}
+			if(crc != (((uint16_t)host_rx[index + 3 + block_length] << 8) | host_rx[index + 4 + block_length]))
+				result->errors++;
+			index += 5 + block_length;
+		}
+	}
+
+	result->start = host_rx_cycle[first] - ok;
+	result->cycles = host_rx_cycle[last] - host_rx_cycle[first];
+	result->bytes = length;
+	result->rd_strobes = bench_RdStrobes() - strobes;
+	result->spi_bytes = exp_spi_bytes - spi_bytes;
+	return 1;
+}
+int8_t bench_Info(bench_transfer* result)
+{
+	memset(result,0,sizeof(bench_transfer));
+	if(bench_SendCommand(API_CMD_GET_INFO,NULL,0) < 0)
+		return -1;
+	uint64_t send = host_tx_cycle;
+	if(bench_WaitRx(2,5) < 0 || host_rx[0] != API_INFO_START)
+		return -1;
+	if(bench_WaitRx(host_rx[1] + 4,1) < 0)
+		return -1;
+
+	result->ttfb = host_rx_cycle[0] - send;
+	result->cycles = host_rx_cycle[host_rx_count - 1] - send;
+	result->bytes = host_rx[1];
+	return 1;
+}
+//writes the save, in pages (API_TRANSFER_BLOCK) or byte per byte (API_TRANSFER_RAW). the save is filled with data
+int8_t bench_Write(uint8_t mode, const uint8_t* data, bench_transfer* result)
+{
+	memset(result,0,sizeof(bench_transfer));
+	if(bench_SendCommand(API_CMD_WRITE_RAM,&mode,1) < 0)
+		return -1;
+	uint64_t send = host_tx_cycle;
+	if(bench_WaitRx(1,5) < 0)
+		return -1;
+	result->ttfb = host_rx_cycle[0] - send;
+
+	//size & OK
+	if(bench_WaitRx(7,1) < 0 || host_rx[0] != API_FILESIZE_START || host_rx[6] != API_OK)
+		return -1;
+	uint32_t size = ((uint32_t)host_rx[1] << 24) | ((uint32_t)host_rx[2] << 16) | ((uint32_t)host_rx[3] << 8) | host_rx[4];
+	bench_SendByte(API_OK);
+	if(bench_Flush() < 0)
+		return -1;
+	uint64_t ok = host_tx_cycle;
+
+	if(bench_WaitRx(8,5) < 0 || host_rx[7] != API_TASK_START)
+		return -1;
+	uint64_t first = host_rx_cycle[7];
+	uint32_t index = 8;
+	double timeout = 2 + (API_WRITE_PAGE_SIZE * 40.0) / host_baud;
+
+	if(mode & API_TRANSFER_BLOCK)
+	{
+		//keep 2 pages in flight, the AVR buffers API_RX_BUFFER_SIZE bytes
+		uint32_t pages = (size + API_WRITE_PAGE_SIZE - 1) / API_WRITE_PAGE_SIZE;
+		uint32_t send_pages = 0;
+		for(uint32_t page = 0;page < pages;page++)
+		{
+			while(send_pages < pages && send_pages < page + 2)
+			{
+				uint32_t page_offset = send_pages * API_WRITE_PAGE_SIZE;
+				uint8_t length = (size - page_offset < API_WRITE_PAGE_SIZE)?size - page_offset:API_WRITE_PAGE_SIZE;
+				uint16_t crc = 0;
+
+				bench_SendByte(API_BLOCK_START);
+				bench_SendByte((send_pages >> 8) & 0xFF);
+				bench_SendByte(send_pages & 0xFF);
+				bench_Send(&data[page_offset],length);
+				for(uint8_t i = 0;i < length;i++)
+					crc = _Crc16(crc,data[page_offset + i]);
+				bench_SendByte(crc >> 8);
+				bench_SendByte(crc & 0xFF);
+				send_pages++;
+			}
+
+			if(bench_WaitRx(index + 3,timeout) < 0 || host_rx[index] != API_OK)
+				return -1;
+			index += 3;
+		}
+	}
+	else
+	{
+		//API_OK + byte, answered by API_VERIFY + what the cart has now. an extra API_OK closes the write
+		for(uint32_t i = 0;i <= size;i++)
+		{
+			bench_SendByte(API_OK);
+			bench_SendByte(i < size?data[i]:0x00);
+			if(i == size)
+				break;
+			if(bench_WaitRx(index + 2,timeout) < 0 || host_rx[index] != API_VERIFY)
+				return -1;
+			if(host_rx[index + 1] != data[i])
+				result->errors++;
+			index += 2;
+		}
+	}
+
+	if(bench_WaitRx(index + 1,timeout) < 0 || host_rx[index] != API_TASK_FINISHED)
+		return -1;
+
+	uint32_t save_size = 0;
+	const uint8_t* save = sim_GetSave(&save_size);
+	for(uint32_t i = 0;i < size && i < save_size;i++)
+	{
+		if(save[i] != data[i])
+			result->errors++;
+	}
+
+	result->start = first - ok;
+	result->cycles = host_rx_cycle[index] - first;
+	result->bytes = size;
+	return 1;
+}
+
+//test carts
+//--------------------------------
+const uint8_t gb_logo[0x30] = {
+	0xCE,0xED,0x66,0x66,0xCC,0x0D,0x00,0x0B,0x03,0x73,0x00,0x83,0x00,0x0C,0x00,0x0D,
+	0x00,0x08,0x11,0x1F,0x88,0x89,0x00,0x0E,0xDC,0xCC,0x6E,0xE6,0xDD,0xDD,0xD9,0x99,
+	0xBB,0xBB,0x67,0x63,0x6E,0x0E,0xEC,0xCC,0xDD,0xDC,0x99,0x9F,0xBB,0xB9,0x33,0x3E
+};
+const uint8_t gba_logo[0x0C] = { 0x24,0xFF,0xAE,0x51,0x69,0x9A,0xA2,0x21,0x3D,0x84,0x82,0x0A };
+
+//the same data on every run, so the numbers only change when the firmware does
+uint32_t _random_state;
+uint8_t _Random(void)
+{
+	_random_state ^= _random_state << 13;
+	_random_state ^= _random_state >> 17;
+	_random_state ^= _random_state << 5;
+	return _random_state & 0xFF;
+}
+uint8_t* _RandomData(uint32_t size, uint32_t seed)
+{
+	uint8_t* data = malloc(size);
+	if(data == NULL)
+		return NULL;
+	_random_state = seed;
+	for(uint32_t i = 0;i < size;i++)
+		data[i] = _Random();
+	return data;
+}
+//MBC5 with 32KB of ram
+int8_t bench_InsertGB(uint32_t size)
+{
+	uint8_t rom_flag = 0;
+	while((0x8000UL << rom_flag) < size)
+		rom_flag++;
+	size = 0x8000UL << rom_flag;
+
+	uint8_t* rom = _RandomData(size,0x6B6B);
+	if(rom == NULL)
+		return -1;
+	memcpy(&rom[0x104],gb_logo,sizeof(gb_logo));
+	memset(&rom[0x134],0,0x10);
+	memcpy(&rom[0x134],"GBBENCH",7);
+	rom[0x143] = 0x80;
+	rom[0x147] = 0x1B;
+	rom[0x148] = rom_flag;
+	rom[0x149] = 0x03;
+	rom[0x14B] = 0x01;
+	uint8_t checksum = 0;
+	for(uint16_t i = 0x134;i < 0x14D;i++)
+		checksum = checksum - rom[i] - 1;
+	rom[0x14D] = checksum;
+
+	gba_inserted = 0;
+	return sim_SetRom(rom,size,0);
+}
+int8_t bench_InsertGBA(uint32_t size)
+{
+	uint8_t* rom = _RandomData(size,0x6BA6BA);
+	if(rom == NULL)
+		return -1;
+	memcpy(&rom[0x04],gba_logo,sizeof(gba_logo));
+	memset(&rom[0xA0],0,0x20);
+	memcpy(&rom[0xA0],"GBABENCH",8);
+	rom[0xB2] = 0x96;
+	uint8_t checksum = 0;
+	for(uint16_t i = 0xA0;i < 0xBD;i++)
+		checksum -= rom[i];
+	rom[0xBD] = checksum - 0x19;
+
+	gba_inserted = 1;
+	return sim_SetRom(rom,size,1);
+}
+
+//the benchmarks
+//--------------------------------
+void _Report(const char* test, bench_transfer* result)
+{
+	char name[64];
+	double frequency = avr->frequency;
+	double per_byte = result->bytes > 1?(double)result->cycles / (result->bytes - 1):0;
+
+	printf("\t%-28s : first byte %8" PRIu64 " cycles (%7.3f ms)",test,result->ttfb,result->ttfb * 1000.0 / frequency);
+	snprintf(name,sizeof(name),"%s.ttfb_cycles",test);
+	bench_Metric(name,result->ttfb);
+	if(result->start > 0)
+	{
+		printf(", data after %6" PRIu64 " cycles",result->start);
+		snprintf(name,sizeof(name),"%s.start_cycles",test);
+		bench_Metric(name,result->start);
+	}
+	if(per_byte > 0)
+	{
+		printf(", %8.2f cycles/byte, %9.0f bytes/s",per_byte,frequency / per_byte);
+		snprintf(name,sizeof(name),"%s.cycles_per_byte",test);
+		bench_Metric(name,per_byte);
+		snprintf(name,sizeof(name),"%s.bytes_per_s",test);
+		bench_Metric(name,frequency / per_byte);
+	}
+	if(result->rd_strobes > 0)
+	{
+		printf(", %5.2f RD/byte",(double)result->rd_strobes / result->bytes);
+		snprintf(name,sizeof(name),"%s.rd_per_byte",test);
+		bench_Metric(name,(double)result->rd_strobes / result->bytes);
+	}
+	if(result->spi_bytes > 0)
+	{
+		printf(", %5.2f SPI/byte",(double)result->spi_bytes / result->bytes);
+		snprintf(name,sizeof(name),"%s.spi_per_byte",test);
+		bench_Metric(name,(double)result->spi_bytes / result->bytes);
+	}
+	printf("\n");
+	if(result->errors > 0)
+	{
+		printf("\t%s : %" PRIu32 " bytes didn't match the cart\n",test,result->errors);
+		failures++;
+	}
+}
+void bench_ReadTest(const char* test, ROM_TYPE type, uint8_t mode, uint32_t length)
+{
+	bench_transfer result;
+	if(bench_Read(type,mode,0,length,&result) < 0)
+		bench_Fail(test,"no (valid) reply");
+	else
+		_Report(test,&result);
+}
+//the raw rom read at every baud rate the firmware accepts. the line is the limit, till the loop can't keep up
+void bench_BaudTest(const char* cart, const uint32_t* bauds, uint8_t count, uint32_t length)
+{
+	uint32_t initial = host_baud;
+	for(uint8_t i = 0;i < count;i++)
+	{
+		char test[64];
+		snprintf(test,sizeof(test),"%s.rom.raw.%" PRIu32,cart,bauds[i]);
+		int8_t ret = bench_SetBaud(bauds[i]);
+		if(ret == 0)
+		{
+			printf("\t%-28s : baud rate not supported\n",test);
+			continue;
+		}
+		if(ret < 0)
+		{
+			bench_Fail(test,"baud rate switch failed");
+			return;
+		}
+		bench_ReadTest(test,TYPE_ROM,API_TRANSFER_RAW,length);
+	}
+	if(host_baud != initial && bench_SetBaud(initial) <= 0)
+		bench_Fail(cart,"couldn't go back to the initial baud rate");
+}
+void bench_GB(uint32_t size, const uint32_t* bauds, uint8_t baud_count, uint32_t baud_length)
+{
+	bench_transfer result;
+	if(bench_InsertGB(size) < 0)
+	{
+		bench_Fail("gb","couldn't create the cart");
+		return;
+	}
+	printf("GB (MBC5, %" PRIu32 "KB rom, 32KB ram) :\n",size / 1024);
+
+	if(bench_Info(&result) < 0)
+		bench_Fail("gb.info","no (valid) reply");
+	else
+		_Report("gb.info",&result);
+
+	bench_ReadTest("gb.rom.raw",TYPE_ROM,API_TRANSFER_RAW,0);
+	bench_ReadTest("gb.rom.block",TYPE_ROM,API_TRANSFER_BLOCK,0);
+
+	uint8_t* save = _RandomData(0x8000,0x5A5A);
+	if(save == NULL)
+		return;
+	if(bench_Write(API_TRANSFER_BLOCK,save,&result) < 0)
+		bench_Fail("gb.ram.write.paged","no (valid) reply");
+	else
+		_Report("gb.ram.write.paged",&result);
+
+	//the byte per byte write is mostly waiting on the line, so it gets different data to prove it wrote something
+	for(uint32_t i = 0;i < 0x8000;i++)
+		save[i] ^= 0xFF;
+	if(bench_Write(API_TRANSFER_RAW,save,&result) < 0)
+		bench_Fail("gb.ram.write.raw","no (valid) reply");
+	else
+		_Report("gb.ram.write.raw",&result);
+	free(save);
+
+	bench_ReadTest("gb.ram.raw",TYPE_RAM,API_TRANSFER_RAW,0);
+	bench_BaudTest("gb",bauds,baud_count,baud_length);
+}
+void bench_GBA(uint32_t size, const uint32_t* bauds, uint8_t baud_count, uint32_t baud_length)
+{
+	bench_transfer result;
+	if(bench_InsertGBA(size) < 0)
+	{
+		bench_Fail("gba","couldn't create the cart");
+		return;
+	}
+	printf("GBA (%" PRIu32 "KB rom, no save) :\n",size / 1024);
+
+	//the first byte of the reads includes finding the rom size (GetGBARomSize)
+	if(bench_Info(&result) < 0)
+		bench_Fail("gba.info","no (valid) reply");
+	else
+		_Report("gba.info",&result);
+
+	bench_ReadTest("gba.rom.raw",TYPE_ROM,API_TRANSFER_RAW,0);
+	bench_ReadTest("gba.rom.block",TYPE_ROM,API_TRANSFER_BLOCK,0);
+	bench_BaudTest("gba",bauds,baud_count,baud_length);
+}
+
+//baseline
+//--------------------------------
+//everything is a cost (lower is better), except the throughput
+uint8_t _HigherIsBetter(const char* name)
+{
+	size_t length = strlen(name);
+	return length > 11 && strcmp(&name[length - 11],"bytes_per_s") == 0;
+}
+int8_t bench_SaveBaseline(const char* filename)
+{
+	FILE* file = fopen(filename,"w");
+	if(file == NULL)
+		return -1;
+	fprintf(file,"# gbbench baseline, %s @ %" PRIu32 "Hz. regenerate with 'make baseline'\n",avr->mmcu,avr->frequency);
+	for(uint16_t i = 0;i < metric_count;i++)
+		fprintf(file,"%s %.3f\n",metrics[i].name,metrics[i].value);
+	fclose(file);
+	return 1;
+}
+//returns the amount of metrics that got worse than the baseline by more than tolerance %
+int32_t bench_CompareBaseline(const char* filename, double tolerance)
+{
+	FILE* file = fopen(filename,"r");
+	if(file == NULL)
+		return -1;
+
+	int32_t regressions = 0;
+	char line[128];
+	printf("compared to %s :\n",filename);
+	while(fgets(line,sizeof(line),file) != NULL)
+	{
+		char name[64];
+		double base;
+		if(line[0] == '#' || sscanf(line,"%63s %lf",name,&base) != 2)
+			continue;
+
+		bench_metric* metric = NULL;
+		for(uint16_t i = 0;i < metric_count && metric == NULL;i++)
+		{
+			if(strcmp(metrics[i].name,name) == 0)
+				metric = &metrics[i];
+		}
+		if(metric == NULL)
+		{
+			printf("\t%-44s : missing\n",name);
+			regressions++;
+			continue;
+		}
+
+		double change = (base != 0)?((metric->value - base) * 100) / base:0;
+		double worse = _HigherIsBetter(name)?-change:change;
+		if(worse > tolerance)
+		{
+			printf("\t%-44s : %12.2f -> %12.2f (%+.2f%%) REGRESSION\n",name,base,metric->value,change);
+			regressions++;
+		}
+		else if(worse < -tolerance)
+			printf("\t%-44s : %12.2f -> %12.2f (%+.2f%%) improved\n",name,base,metric->value,change);
+	}
+	fclose(file);
+	return regressions;
+}
+
+//main
+//--------------------------------
+void _Usage(void)
+{
+	printf("usage : gbbench [options] firmware.elf\n");
+	printf("\t-mcu name        : atmega8 or atmega32 (default atmega8)\n");
+	printf("\t-freq hz         : clock of the firmware (default 16000000 on atmega8, 8000000 otherwise)\n");
+	printf("\t-baud rate       : rate the firmware starts at (default 1000000)\n");
+	printf("\t-gbsize bytes    : size of the GB test rom (default 0x40000)\n");
+	printf("\t-gbasize bytes   : size of the GBA test rom (default 0x100000)\n");
+	printf("\t-length bytes    : bytes read per baud rate (default 0x4000)\n");
+	printf("\t-save file       : write the results as baseline\n");
+	printf("\t-baseline file   : compare the results to a baseline\n");
+	printf("\t-tolerance %%     : change allowed before it counts as regression (default 1)\n");
+}
+int main(int argc, char** argv)
+{
+	const char* mcu = "atmega8";
+	const char* elf = NULL;
+	const char* save = NULL;
+	const char* baseline = NULL;
+	uint32_t frequency = 0;
+	uint32_t gb_size = 0x40000;
+	uint32_t gba_size = 0x100000;
+	uint32_t baud_length = 0x4000;
+	double tolerance = 1;
+
+	for(int i = 1;i < argc;i++)
+	{
+		if(strcmp(argv[i],"-mcu") == 0 && i + 1 < argc)
+			mcu = argv[++i];
+		else if(strcmp(argv[i],"-freq") == 0 && i + 1 < argc)
+			frequency = strtoul(argv[++i],NULL,0);
+		else if(strcmp(argv[i],"-baud") == 0 && i + 1 < argc)
+			host_baud = strtoul(argv[++i],NULL,0);
+		else if(strcmp(argv[i],"-gbsize") == 0 && i + 1 < argc)
+			gb_size = strtoul(argv[++i],NULL,0);
+		else if(strcmp(argv[i],"-gbasize") == 0 && i + 1 < argc)
+			gba_size = strtoul(argv[++i],NULL,0);
+		else if(strcmp(argv[i],"-length") == 0 && i + 1 < argc)
+			baud_length = strtoul(argv[++i],NULL,0);
+		else if(strcmp(argv[i],"-save") == 0 && i + 1 < argc)
+			save = argv[++i];
+		else if(strcmp(argv[i],"-baseline") == 0 && i + 1 < argc)
+			baseline = argv[++i];
+		else if(strcmp(argv[i],"-tolerance") == 0 && i + 1 < argc)
+			tolerance = strtod(argv[++i],NULL);
+		else if(argv[i][0] != '-')
+			elf = argv[i];
+		else
+		{
+			_Usage();
+			return 1;
+		}
+	}
+	if(elf == NULL || host_baud == 0 || gb_size < 0x8000 || gb_size > 0x800000 || gba_size < 0x400 || gba_size > 0x2000000)
+	{
+		_Usage();
+		return 1;
+	}
+	if(frequency == 0)
+		frequency = (strcmp(mcu,"atmega8") == 0)?16000000:8000000;
+
+	if(elf_read_firmware(elf,&firmware) != 0)
+	{
+		printf("couldn't load %s\n",elf);
+		return 1;
+	}
+	avr = avr_make_mcu_by_name(mcu);
+	if(avr == NULL)
+	{
+		printf("simavr doesn't know %s\n",mcu);
+		return 1;
+	}
+	avr_init(avr);
+	avr_load_firmware(avr,&firmware);
+	avr->frequency = frequency;
+
+	//we are the host on the other end of the USART, not the console
+	uint32_t flags = 0;
+	avr_ioctl(avr,AVR_IOCTL_UART_GET_FLAGS('0'),&flags);
+	flags &= ~AVR_UART_FLAG_STDIO;
+	avr_ioctl(avr,AVR_IOCTL_UART_SET_FLAGS('0'),&flags);
+	uart_input = avr_io_getirq(avr,AVR_IOCTL_UART_GETIRQ('0'),UART_IRQ_INPUT);
+	avr_irq_register_notify(avr_io_getirq(avr,AVR_IOCTL_UART_GETIRQ('0'),UART_IRQ_OUTPUT),_UartByte,NULL);
+
+	wiring = NULL;
+	for(uint8_t i = 0;i < sizeof(wirings) / sizeof(wirings[0]);i++)
+	{
+		if(strcmp(wirings[i].mcu,mcu) == 0)
+			wiring = &wirings[i];
+	}
+	if(wiring == NULL)
+	{
+		printf("the bench has no wiring for %s\n",mcu);
+		return 1;
+	}
+
+	//watch everything the firmware puts on the bus. the cart, button & sense pins have to be there before it boots
+	bench_BusReset();
+	for(char port = 'A';port <= 'D';port++)
+	{
+		avr_irq_t* irq = avr_io_getirq(avr,AVR_IOCTL_IOPORT_GETIRQ(port),IOPORT_IRQ_REG_PORT);
+		if(irq == NULL)
+			continue;
+		avr_irq_register_notify(irq,_PortChanged,(void*)(uintptr_t)port);
+		avr_irq_register_notify(avr_io_getirq(avr,AVR_IOCTL_IOPORT_GETIRQ(port),IOPORT_IRQ_DIRECTION_ALL),_PortChanged,(void*)(uintptr_t)port);
+	}
+	if(wiring->expander)
+	{
+		//power on state : all pins input
+		for(uint8_t i = 0;i < BENCH_LINES;i++)
+		{
+			memset(&expanders[i],0,sizeof(bench_expander));
+			expanders[i].regs[EXP_IODIR] = 0xFF;
+		}
+		spi_input = avr_io_getirq(avr,AVR_IOCTL_SPI_GETIRQ('0'),SPI_IRQ_INPUT);
+		avr_irq_register_notify(avr_io_getirq(avr,AVR_IOCTL_SPI_GETIRQ('0'),SPI_IRQ_OUTPUT),_SpiByte,NULL);
+	}
+	bench_UpdateBus();
+
+	//let the firmware boot & check it was build the way we are wired
+	uint32_t f_cpu = 0;
+	uint8_t build = 0xFF;
+	if(bench_RunFor(_Cycles(0.05)) < 0 || bench_Handshake(&f_cpu,&build) < 0)
+	{
+		printf("no handshake from the firmware\n");
+		return 1;
+	}
+	if(f_cpu != frequency)
+	{
+		printf("the firmware is build for %" PRIu32 "Hz, use -freq %" PRIu32 "\n",f_cpu,f_cpu);
+		return 1;
+	}
+	if(build != wiring->build)
+	{
+		printf("the firmware is build mode %u, the bench wires %s as %s\n",build,mcu,wiring->name);
+		return 1;
+	}
+
+	printf("%s, %s build @ %" PRIu32 "Hz, %" PRIu32 " baud\n",mcu,wiring->name,frequency,host_baud);
+	const uint32_t rates[] = { 115200, 250000, 500000, 1000000, 2000000 };
+	uint32_t bauds[sizeof(rates) / sizeof(rates[0])];
+	uint8_t baud_count = 0;
+	for(uint8_t i = 0;i < sizeof(rates) / sizeof(rates[0]);i++)
+	{
+		if(rates[i] <= frequency / 8)
+			bauds[baud_count++] = rates[i];
+	}
+
+	bench_GB(gb_size,bauds,baud_count,baud_length);
+	bench_GBA(gba_size,bauds,baud_count,baud_length);
+	if(bench_Contentions() > 0)
+	{
+		printf("%" PRIu64 " RD strobes with bus contention\n",bench_Contentions());
+		failures++;
+	}
+
+	int ret = failures > 0;
+	if(save != NULL && !ret && bench_SaveBaseline(save) < 0)
+	{
+		printf("couldn't write %s\n",save);
+		ret = 1;
+	}
+	if(baseline != NULL)
+	{
+		int32_t regressions = bench_CompareBaseline(baseline,tolerance);
+		if(regressions < 0)
+		{
+			printf("no baseline at %s, create it with 'make baseline'\n",baseline);
+			ret = 1;
+		}
+		else if(regressions > 0)
+		{
+			printf("%" PRId32 " regressions\n",regressions);
+			ret = 1;
+		}
+		else
+			printf("\tno regressions\n");
+	}
+
+	avr_terminate(avr);
+	return ret;
+}
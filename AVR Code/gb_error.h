@@ -19,6 +19,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define ERR_LOGO_CHECK -8
 #define ERR_NO_INFO -9
 #define ERR_FAULT_CART -10
+#define ERR_INVALID_PARAM -11
+#define ERR_TIMEOUT -12
 #define ERR_NO_MBC -20
 #define ERR_MBC_UNSUPPORTED -21
 #define ERR_MBC_SAVE_UNSUPPORTED -22
@@ -22,6 +22,137 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #endif
 
 
+#ifdef GPIO_EXTENDER_MODE
+//shadow copies of the expander registers we write. every register write is a full SPI/I2C transaction,
+//so writes that wouldn't change the register are skipped.
+typedef struct
+{
+	uint8_t valid;
+	uint8_t iodir;
+	uint8_t gppu;
+	uint8_t gpio;
+} mcp_shadow;
+mcp_shadow _mcp_shadow[3];
+
+#define EXPANDER_INDEX(x) ((x - BASE_ADDR_CHIPS) >> 1)
+#define SHADOW_IODIR 0x01
+#define SHADOW_GPPU 0x02
+#define SHADOW_GPIO 0x04
+
+#ifdef _SPI_MODE
+//the expanders share the SPI bus and CS, so only 1 of them can have a transaction open.
+//with IOCON.SEQOP set the register pointer doesn't move after a byte, so as long as the next access goes
+//to the same chip, register & direction, the transaction is kept open and only the data byte is clocked.
+//this does NOT make dumps faster : the MCP23S08 only takes an opcode (chip & read/write) right after CS falls,
+//and a dumped byte (Read8BitBlock) is a write to ADDR_CHIP_1 followed by a read from DATA_CHIP_1.
+//those can't share a transaction, so it is 3 + 3 SPI bytes per dumped byte, same as the library calls.
+//only runs on 1 register (like the eeprom bit clocking) skip the framing. gbbench reports SPI/byte
+#define IOCON_SEQOP 0x20
+#define IOCON_HAEN 0x08
+
+//opcode (chip address + read bit) & register of the open transaction. opcode 0 means none is open
+uint8_t _exp_stream_op = 0;
+uint8_t _exp_stream_reg = 0;
+
+inline uint8_t _ExpanderTransfer(uint8_t data)
+{
+	SPDR = data;
+	while(!(SPSR & (1 << SPIF)));
+	return SPDR;
+}
+void EndExpanderStream(void)
+{
+	if(_exp_stream_op == 0)
+		return;
+	
+	SetPin(EXPANDER_CS_PORT,EXPANDER_CS);
+	_exp_stream_op = 0;
+}
+inline void _ExpanderStream(uint8_t opcode, uint8_t reg)
+{
+	if(_exp_stream_op == opcode && _exp_stream_reg == reg)
+		return;
+	
+	EndExpanderStream();
+	ClearPin(EXPANDER_CS_PORT,EXPANDER_CS);
+	_ExpanderTransfer(opcode);
+	_ExpanderTransfer(reg);
+	_exp_stream_op = opcode;
+	_exp_stream_reg = reg;
+}
+#else
+void EndExpanderStream(void)
+{
+	return;
+}
+#endif
+
+void InitExpander(uint8_t chip)
+{
+	//the library drives the CS itself, so nothing can be left open
+	EndExpanderStream();
+	mcp23008_init(chip);
+#ifdef _SPI_MODE
+	//byte mode, so the register pointer stays on the register we are streaming to/from.
+	//the rest of IOCON is left as the library set it
+	uint8_t iocon = 0;
+	mcp23008_ReadReg(chip,IOCON,&iocon);
+	mcp23008_WriteReg(chip,IOCON,iocon | IOCON_SEQOP | IOCON_HAEN);
+#endif
+	//we don't know what the init left in the registers, so the first write of each always goes out
+	_mcp_shadow[EXPANDER_INDEX(chip)].valid = 0;
+}
+uint8_t ReadExpanderReg(uint8_t chip, uint8_t reg)
+{
+#ifdef _SPI_MODE
+	_ExpanderStream(chip | 0x01,reg);
+	return _ExpanderTransfer(0x00);
+#else
+	uint8_t value = 0;
+	mcp23008_ReadReg(chip,reg,&value);
+	return value;
+#endif
+}
+void WriteExpanderReg(uint8_t chip, uint8_t reg, uint8_t value)
+{
+	mcp_shadow* shadow = &_mcp_shadow[EXPANDER_INDEX(chip)];
+	uint8_t* cached;
+	uint8_t flag;
+	
+	switch(reg)
+	{
+		case IODIR:
+			cached = &shadow->iodir;
+			flag = SHADOW_IODIR;
+			break;
+		case GPPU:
+			cached = &shadow->gppu;
+			flag = SHADOW_GPPU;
+			break;
+		case GPIO:
+			cached = &shadow->gpio;
+			flag = SHADOW_GPIO;
+			break;
+		default:
+			EndExpanderStream();
+			mcp23008_WriteReg(chip,reg,value);
+			return;
+	}
+	
+	if((shadow->valid & flag) && *cached == value)
+		return;
+	
+#ifdef _SPI_MODE
+	_ExpanderStream(chip,reg);
+	_ExpanderTransfer(value);
+#else
+	mcp23008_WriteReg(chip,reg,value);
+#endif
+	*cached = value;
+	shadow->valid |= flag;
+}
+#endif
+
 //pin functions
 //--------------------------------
 inline void SetControlPin(uint8_t Pin,uint8_t state)
@@ -35,6 +166,47 @@ inline void SetControlPin(uint8_t Pin,uint8_t state)
 		ClearPin(CTRL_PORT,Pin); // Pin goes low
 	}	
 }
+//settle time used by GET_DATA, for the rest of the session
+uint8_t _bus_settle = BUS_SETTLE_DEFAULT;
+
+//read_region reads a known region of the cart & returns a checksum of it.
+//the region is read with decreasing settle times. the fastest setting that still returns the same data as the slowest
+//over a few reads is kept, plus a margin. fast carts get read faster & marginal carts get more slack.
+void CalibrateBusTiming(uint16_t (*read_region)(void))
+{
+#ifndef GPIO_EXTENDER_MODE
+	_bus_settle = BUS_SETTLE_MAX;
+	uint16_t reference = read_region();
+	
+	//if even the slowest setting isn't stable, we can't say anything about the cart. keep the default
+	if(read_region() != reference)
+	{
+		_bus_settle = BUS_SETTLE_DEFAULT;
+		return;
+	}
+	
+	uint8_t fastest = BUS_SETTLE_MAX;
+	for(int8_t settle = BUS_SETTLE_MAX - 1;settle >= 0;settle--)
+	{
+		_bus_settle = settle;
+		uint8_t stable = 1;
+		for(uint8_t i = 0;i < BUS_CALIBRATION_READS;i++)
+		{
+			if(read_region() != reference)
+			{
+				stable = 0;
+				break;
+			}
+		}
+		if(!stable)
+			break;
+		fastest = settle;
+	}
+	
+	fastest += BUS_SETTLE_MARGIN;
+	_bus_settle = fastest > BUS_SETTLE_MAX ? BUS_SETTLE_MAX : fastest;
+#endif
+}
 int8_t CheckControlPin(uint8_t Pin)
 {
 	if((CTRL_PIN & (1<< Pin)) == 0)
@@ -42,16 +214,52 @@ int8_t CheckControlPin(uint8_t Pin)
 	return HIGH;
 }
 
+//direction of the data & address bus, so setting a bus to the direction it already has costs nothing.
+//the pull ups are part of the state : the data bus has them enabled as input, the address bus never does.
+uint8_t _data_bus_state = BUS_UNKNOWN;
+uint8_t _addr_bus_state = BUS_UNKNOWN;
+
+//forget the tracked state, for when the pins are (re)initialized. the next Set*PinsAs* call always goes out
+void ResetBusState(void)
+{
+	_data_bus_state = BUS_UNKNOWN;
+	_addr_bus_state = BUS_UNKNOWN;
+}
+uint8_t GetDataBusState(void)
+{
+	return _data_bus_state;
+}
+uint8_t GetAddressBusState(void)
+{
+	return _addr_bus_state;
+}
+//switches the bus between the 8bit (GBA SRAM) & 24bit (GBA ROM) layout without re-initializing anything.
+//both use the same pins and the same idle state (address out, data in, control lines high), so only that is restored.
+//the pins need to be setup with Setup_Pins_8bitMode/Setup_Pins_24bitMode before
+void SwitchBusMode(void)
+{
+	SetPin(CTRL_PORT,WD);
+	SetPin(CTRL_PORT,RD);
+	SetPin(CTRL_PORT,CS1);
+	SetPin(CTRL_PORT,CS2);
+	
+	SetAddressPinsAsOutput();
+	SetDataPinsAsInput();
+}
 inline void SetDataPinsAsInput(void)
 {
+	if(_data_bus_state == INPUT)
+		return;
+	_data_bus_state = INPUT;
+	
 	//set as input;
 #ifdef GPIO_EXTENDER_MODE	
-	mcp23008_WriteReg(DATA_CHIP_1,IODIR,0xFF);
+	WriteExpanderReg(DATA_CHIP_1,IODIR,0xFF);
 	
-	//enable pull up
-	mcp23008_WriteReg(DATA_CHIP_1,GPPU,0xFF);
+	//enable pull up. only written once, as SetDataPinsAsOutput leaves them on
+	WriteExpanderReg(DATA_CHIP_1,GPPU,0xFF);
 #else
-	DATA_DDR &= ~(0xFF); //0b00000000;
+	DATA_DDR = 0x00; //0b00000000;
 	//enable pull up resistors
 	DATA_PORT = 0xFF;
 #endif
@@ -59,13 +267,15 @@ inline void SetDataPinsAsInput(void)
 }
 inline void SetDataPinsAsOutput(void)
 {
+	if(_data_bus_state == OUTPUT)
+		return;
+	_data_bus_state = OUTPUT;
+	
 	//set as output
 #ifdef GPIO_EXTENDER_MODE
-	//disable pull ups
-	mcp23008_WriteReg(DATA_CHIP_1,GPPU,0x00);
-	
-	//set output
-	mcp23008_WriteReg(DATA_CHIP_1,IODIR,0x00);	
+	//the pull ups are left enabled, the mcp23008 only applies them to pins set as input.
+	//that way switching direction is a single register write
+	WriteExpanderReg(DATA_CHIP_1,IODIR,0x00);	
 #else
 	DATA_DDR |= (0xFF);//0b11111111;
 	//set output as 0x00
@@ -75,14 +285,20 @@ inline void SetDataPinsAsOutput(void)
 
 inline void SetAddressPinsAsOutput(void)
 {
+	if(_addr_bus_state == OUTPUT)
+		return;
+	_addr_bus_state = OUTPUT;
+	
 #ifdef GPIO_EXTENDER_MODE
 	//disable pull ups
-	mcp23008_WriteReg(ADDR_CHIP_1,GPPU,0x00);
-	mcp23008_WriteReg(ADDR_CHIP_2,GPPU,0x00);
+	WriteExpanderReg(ADDR_CHIP_1,GPPU,0x00);
+	WriteExpanderReg(ADDR_CHIP_2,GPPU,0x00);
 	
 	//set output
-	mcp23008_WriteReg(ADDR_CHIP_1,IODIR,0x00);
-	mcp23008_WriteReg(ADDR_CHIP_2,IODIR,0x00);
+	WriteExpanderReg(ADDR_CHIP_1,IODIR,0x00);
+	WriteExpanderReg(ADDR_CHIP_2,IODIR,0x00);
+#elif defined(SHIFTING_MODE)
+	//the 595's always drive the address bus
 #else
 	ADDR_DDR1 = 0xFF;
 	ADDR_DDR2 = 0xFF;
@@ -94,13 +310,19 @@ inline void SetAddressPinsAsOutput(void)
 }
 inline void SetAddressPinsAsInput(void)
 {
+	if(_addr_bus_state == INPUT)
+		return;
+	_addr_bus_state = INPUT;
+	
 	//we don't enable pull ups here cause we need to be able to tell the differenc between 0xFFFF & open bus...
 #ifdef GPIO_EXTENDER_MODE
-	mcp23008_WriteReg(ADDR_CHIP_1,IODIR,0xFF);
-	mcp23008_WriteReg(ADDR_CHIP_2,IODIR,0xFF);	
+	WriteExpanderReg(ADDR_CHIP_1,IODIR,0xFF);
+	WriteExpanderReg(ADDR_CHIP_2,IODIR,0xFF);	
+#elif defined(SHIFTING_MODE)
+	//nothing to do, the 595's can't be read back
 #else
-	ADDR_DDR1 &= ~(0xFF);
-	ADDR_DDR2 &= ~(0xFF);
+	ADDR_DDR1 = 0x00;
+	ADDR_DDR2 = 0x00;
 #endif
 }
 
@@ -19,13 +19,24 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 //define all pins for a specific chip!
 #ifdef GPIO_EXTENDER_MODE	
 	
-	#define GET_DATA(x) { mcp23008_ReadReg(DATA_CHIP_1, GPIO,&x);}
-	#define SET_DATA(x) { mcp23008_WriteReg(DATA_CHIP_1, GPIO,x);}
-	
-	#define SET_ADDR1(x) { mcp23008_WriteReg(ADDR_CHIP_1,GPIO,(uint8_t)(x & 0xFF)); }
-	#define SET_ADDR(x) { mcp23008_WriteReg(ADDR_CHIP_1,GPIO,(uint8_t)(x & 0xFF));mcp23008_WriteReg(ADDR_CHIP_2,GPIO,(uint8_t)(x >> 8) & 0xFF); }
-	#define GET_ADDR1_DATA(x) {mcp23008_ReadReg(ADDR_CHIP_1, GPIO,&x);}
-	#define GET_ADDR2_DATA(x) {mcp23008_ReadReg(ADDR_CHIP_2, GPIO,&x);}
+	#define GET_DATA(x) { x = ReadExpanderReg(DATA_CHIP_1,GPIO);}
+	#define GET_DATA_SETTLED(x,settle) GET_DATA(x)
+	#define SET_DATA(x) { WriteExpanderReg(DATA_CHIP_1, GPIO,x);}
+	
+	#define SET_ADDR1(x) { WriteExpanderReg(ADDR_CHIP_1,GPIO,(uint8_t)(x & 0xFF)); }
+	#define SET_ADDR(x) { WriteExpanderReg(ADDR_CHIP_1,GPIO,(uint8_t)(x & 0xFF));WriteExpanderReg(ADDR_CHIP_2,GPIO,(uint8_t)(x >> 8) & 0xFF); }
+	#define GET_ADDR1_DATA(x) { x = ReadExpanderReg(ADDR_CHIP_1,GPIO);}
+	#define GET_ADDR2_DATA(x) { x = ReadExpanderReg(ADDR_CHIP_2,GPIO);}
+	
+	//CS of the expanders, all 3 share it and are selected by their hardware address. it is the one the spi library drives
+	#ifdef _SPI_MODE
+	#include "spi.h"
+	#if !defined(SPI_PORT) || !defined(SPI_SS)
+	#error the spi library doesn't define SPI_PORT/SPI_SS, the expander CS can't be driven
+	#endif
+	#define EXPANDER_CS_PORT SPI_PORT
+	#define EXPANDER_CS SPI_SS
+	#endif
 	
 	#define CTRL_DDR DDRC
 	#define CTRL_PORT PORTC
@@ -48,20 +59,45 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 	
 #elif defined(SHIFTING_MODE)
 
-	#define DATA_PORT PORTB
-	#define DATA_DDR DDRB
-	#define DATA_PIN PINB
+	//the address goes out through 2 74HC595's driven by the hardware SPI. because MOSI/SCK live on PORTB,
+	//the data bus is on PORTA, so this needs a chip with a PORTA (atmega16/32). wiring :
+	//	D0-D7	-> PA0-PA7
+	//	595 SER (both)	-> MOSI (PB5), 595 SRCLK (both) -> SCK (PB7). SS (PB4) is kept as output so the SPI stays master
+	//	595 RCLK A0-A7	-> PC4
+	//	595 RCLK A8-A15	-> PC5
+	//	RD PD2, WD PD3, CS1 PD4, CS2 PD5, button PD6
+	//the 595's can only be written, so the 24bit (GBA) bus, which reads data back over the address lines, is not supported.
+	//SET_ADDR/GET_ADDR*_DATA are stubs so 24bit_cart.c still builds; GetGBAInfo refuses the cart when NO_GBA_SUPPORT is set
+	#if !defined(PORTA) && !defined(SIM_MODE)
+	#error SHIFTING_MODE needs a chip with a PORTA (atmega16/32). set MCU in the Makefile
+	#endif
+	#define NO_GBA_SUPPORT
+	#define SET_ADDR1(x)
+	#define SET_ADDR(x)
+	#define GET_ADDR1_DATA(x) { x = 0xFF; }
+	#define GET_ADDR2_DATA(x) { x = 0xFF; }
+	
+	#define DATA_PORT PORTA
+	#define DATA_DDR DDRA
+	#define DATA_PIN PINA
+	
+	#define GET_DATA(x) {BUS_SETTLE(_bus_settle);x = DATA_PIN;}
+	#define GET_DATA_SETTLED(x,settle) {BUS_SETTLE(settle);x = DATA_PIN;}
+	#define SET_DATA(x) (DATA_PORT = x)
 	
-	#define GET_DATA(x) (x = DATA_PIN)
-	#define SET_DATA(x) (DATA_PORT = byte)
+	#define SPI_DDR DDRB
+	#define SPI_SS PB4
+	#define SPI_MOSI PB5
+	#define SPI_SCK PB7
 	
+	//both 595's have their SER on MOSI & SRCLK on SCK, but each has its own RCLK (latch).
+	//that way a byte can be shifted into both and only latched on the one that needs it.
 	#define ADDR_CTRL_DDR DDRC
 	#define ADDR_CTRL_PORT PORTC
 	#define ADDR_CTRL_PIN PINC
 	
-	#define ADDR_CTRL_DATA PC2
-	#define ADDR_CTRL_CLK PC3
 	#define ADDR_CTRL_LATCH PC4
+	#define ADDR_CTRL_LATCH_HIGH PC5
 	
 	#define CTRL_DDR DDRD
 	#define CTRL_PORT PORTD
@@ -91,10 +127,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 	#define ADDR_PIN1 PINB
 	#define ADDR_PIN2 PINC
 	
-	//add nops as we were reading faster then a GB cart could output @ 8Mhz
-	#define GET_DATA(x) {asm("nop");asm("nop");x = DATA_PIN;}
+	//we can read faster then a GB cart can output, so wait the calibrated settle time (see CalibrateBusTiming)
+	#define GET_DATA(x) {BUS_SETTLE(_bus_settle);x = DATA_PIN;}
+	#define GET_DATA_SETTLED(x,settle) {BUS_SETTLE(settle);x = DATA_PIN;}
 	#define SET_DATA(x) (DATA_PORT = x)
 	
+	#define SET_ADDR1(x) (ADDR_PORT1 = x)
 	#define SET_ADDR(x) { ADDR_PORT1 = x >> 8; ADDR_PORT2 = (uint8_t)(x & 0xFF); }
 	#define GET_ADDR1_DATA(x) {asm("nop");x = ADDR_PIN1;}
 	#define GET_ADDR2_DATA(x) {asm("nop");x = ADDR_PIN2;}
@@ -116,17 +154,56 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 	
 #endif
 
+#ifdef GPIO_EXTENDER_MODE
+	//an expander transaction takes longer then any cart needs, so there is nothing to calibrate
+	#define BUS_SETTLE(x)
+	#define BUS_SETTLE_DEFAULT 0
+#else
+	#include <util/delay_basic.h>
+	
+	//settle time between pulling RD low and sampling the bus, in steps of 3 cycles.
+	//0 is only the test & branch (~2 cycles, the same as the old 2 nops)
+	#define BUS_SETTLE(x) { if(x) _delay_loop_1(x); }
+	
+	#define BUS_SETTLE_DEFAULT 1
+	#define BUS_SETTLE_MAX 8
+	#define BUS_SETTLE_MARGIN 1
+	#define BUS_CALIBRATION_READS 4
+	
+	//checksum used to compare the calibration reads
+	#define BUS_CHECKSUM(sum,x) (sum = ((sum << 1) | (sum >> 15)) ^ (x))
+#endif
+
 #define HIGH 1
 #define LOW 0
 
 #define INPUT 0
 #define OUTPUT 1
+#define BUS_UNKNOWN 0xFF
 
-#define SetPin(x,y) (x |= (1<<y))
-#define ClearPin(x,y) (x &= ~(1<<y))
+#ifdef SIM_MODE
+	//the simulated cart needs to see the control pin edges (see sim/)
+	#define SetPin(x,y) sim_SetPin(&(x),y)
+	#define ClearPin(x,y) sim_ClearPin(&(x),y)
+#else
+	#define SetPin(x,y) (x |= (1<<y))
+	#define ClearPin(x,y) (x &= ~(1<<y))
+#endif
 int8_t CheckControlPin(uint8_t Pin);
 void SetControlPin(uint8_t Pin,uint8_t state);
 void SetDataPinsAsOutput(void);
 void SetDataPinsAsInput(void);
 void SetAddressPinsAsOutput(void);
 void SetAddressPinsAsInput(void);
+void SwitchBusMode(void);
+void ResetBusState(void);
+uint8_t GetDataBusState(void);
+uint8_t GetAddressBusState(void);
+extern uint8_t _bus_settle;
+void CalibrateBusTiming(uint16_t (*read_region)(void));
+#ifdef GPIO_EXTENDER_MODE
+void InitExpander(uint8_t chip);
+void WriteExpanderReg(uint8_t chip, uint8_t reg, uint8_t value);
+uint8_t ReadExpanderReg(uint8_t chip, uint8_t reg);
+void EndExpanderStream(void);
+#endif
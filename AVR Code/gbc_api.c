@@ -20,6 +20,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <string.h>
 #include <ctype.h>
 #include <stdint.h>
+#include <util/crc16.h>
+#include <avr/pgmspace.h>
 #include "serial.h"
 #include "gb_error.h"
 #include "gb_pins.h"
@@ -92,10 +94,12 @@ int8_t API_GetGameInfo(void)
 	
 	if(_gba_cart)
 	{
+		CalibrateGBABusTiming();
 		ret = GetGBAInfo(gameInfo.Name,&gameInfo.CartFlag);
 	}
 	else
 	{
+		CalibrateGBBusTiming();
 		ret = GetGBInfo(gameInfo.Name,&gameInfo.RomSizeFlag,&gameInfo.RamSize,&gameInfo.CartFlag);
 	}
 	
@@ -105,17 +109,9 @@ int8_t API_GetGameInfo(void)
 	API_ResetGameInfo();
 	return ret;
 }
-int8_t API_Get_Memory(ROM_TYPE type,int8_t _gbaMode)
-{	
-	API_SetupPins(_gbaMode);
-	
-	int8_t ret = API_GetGameInfo();
-	if(ret < 1)
-	{
-		API_Send_Abort(API_ABORT_CMD);
-		return ret;
-	}
-			
+//calculates the size of the rom/ram of the cart into gameInfo.fileSize
+int8_t API_GetMemorySize(ROM_TYPE type)
+{
 	if(type == TYPE_ROM)
 	{
 		if(_gba_cart)
@@ -132,9 +128,8 @@ int8_t API_Get_Memory(ROM_TYPE type,int8_t _gbaMode)
 		if(_gba_cart)
 		{
 			gameInfo.fileSize = GetGBARamSize(&gameInfo.CartFlag);
-			if(gameInfo.fileSize = 0)
+			if(gameInfo.fileSize == 0)
 			{
-				API_Send_Abort(API_ABORT_CMD);
 				return ERR_NO_SAVE;
 			}
 		}
@@ -145,12 +140,12 @@ int8_t API_Get_Memory(ROM_TYPE type,int8_t _gbaMode)
 			
 			if(GetRamDetails(&end_addr, &_banks,gameInfo.RamSize) < 0)
 			{
-				//ram error, BAIL IT
-				API_Send_Abort(API_ABORT_CMD);
-				return ERR_NO_SAVE;
+				//ram error, BAIL IT. unless it is a clock cart without ram, which still has the clock to save
+				if(!(LoadedMBC.Flags & MBC_FLAG_RTC))
+					return ERR_NO_SAVE;
+				gameInfo.fileSize = 0;
 			}
-			
-			if(end_addr < 0xC000)
+			else if(end_addr < 0xC000)
 			{
 				gameInfo.fileSize = end_addr - 0xA000UL;
 			}
@@ -158,12 +153,46 @@ int8_t API_Get_Memory(ROM_TYPE type,int8_t _gbaMode)
 			{
 				gameInfo.fileSize = 0x2000UL * _banks;
 			}
+			
+			if(LoadedMBC.Flags & MBC_FLAG_RTC)
+				gameInfo.fileSize += GB_RTC_SIZE;
 		}		
 	}
+	return 1;
+}
+int8_t API_Get_Memory(ROM_TYPE type,int8_t _gbaMode,uint8_t mode,uint32_t offset,uint32_t length)
+{	
+	API_SetupPins(_gbaMode);
 	
+	int8_t ret = API_GetGameInfo();
+	if(ret < 1)
+	{
+		API_Send_Abort(API_ABORT_CMD);
+		return ret;
+	}
+			
+	ret = API_GetMemorySize(type);
+	if(ret < 0)
+	{
+		API_Send_Abort(API_ABORT_CMD);
+		return ret;
+	}
+	
+	//the requested range has to start within the memory. a length of 0 (or one running past the end) means 'till the end'
+	if(offset > gameInfo.fileSize)
+	{
+		API_Send_Abort(API_ABORT_CMD);
+		return ERR_INVALID_PARAM;
+	}
+	if(length == 0 || length > gameInfo.fileSize - offset)
+		length = gameInfo.fileSize - offset;
+	
+	//the header always reports the full size, so the host can check it against what it already has
 	API_Send_Cart_Type();
 	API_Send_Name();
 	API_Send_Size();	
+	if(type == TYPE_RAM)
+		API_Send_Rtc();
 	
 	if(API_WaitForOK() <= 0)
 	{
@@ -173,18 +202,17 @@ int8_t API_Get_Memory(ROM_TYPE type,int8_t _gbaMode)
 	
 	if(type == TYPE_RAM)
 	{
-		return API_GetRam();
+		return API_GetRam(mode,offset,length);
 	}
 	else
 	{
-		return API_GetRom();
+		return API_GetRom(mode,offset,length);
 	}
 }
-int8_t API_WriteGBRam(void)
+int8_t API_WriteGBRam(uint8_t mode)
 {	
 	//reset game cart. this causes all banks & states to reset
-	ClearPin(CTRL_PORT,CS2);
-	SetPin(CTRL_PORT,CS2);
+	ResetGBCart();
 	
 	gameInfo.fileSize = 0;
 	int8_t ret = 0;
@@ -192,25 +220,24 @@ int8_t API_WriteGBRam(void)
 	uint16_t end_addr = 0xC000;
 	uint8_t banks = 0;
 	
-	if(GetRamDetails(&end_addr,&banks,gameInfo.RamSize) < 0)
+	//the raw mode only writes the ram, the clock of MBC3 timer carts can only be written in block mode.
+	//the host leaves it out with API_TRANSFER_NO_RTC, for saves without the footer
+	int8_t ram = GetRamDetails(&end_addr,&banks,gameInfo.RamSize);
+	uint8_t rtc = (LoadedMBC.Flags & MBC_FLAG_RTC) && (mode & API_TRANSFER_BLOCK) && !(mode & API_TRANSFER_NO_RTC);
+	if(API_GetMemorySize(TYPE_RAM) < 0 || (ram < 0 && !rtc))
 	{	
 		API_Send_Abort(API_ABORT_CMD);
 		ret = ERR_NO_SAVE;
 		goto end_function;
 	}
+	if(!rtc && (LoadedMBC.Flags & MBC_FLAG_RTC))
+		gameInfo.fileSize -= GB_RTC_SIZE;
 		
 	//precheck and send everything
 	//for WRITERAM we need to send Ram size, wait for the OK(0x80) or NOK(anything NOT 0x80) signal, and then start receiving.
-	if(end_addr < 0xC000)
-	{
-		gameInfo.fileSize = end_addr - 0xA000UL;
-	}
-	else
-	{
-		gameInfo.fileSize = 0x2000UL * banks;
-	}
-	
 	API_Send_Size();
+	if(rtc)
+		API_Send_Rtc();
 	if(API_WaitForOK() <= 0)
 	{
 		API_Send_Abort(API_ABORT_CMD);
@@ -220,6 +247,12 @@ int8_t API_WriteGBRam(void)
 	
 	
 	//we got the OK!	
+	if(mode & API_TRANSFER_BLOCK)
+	{
+		ret = API_ReceivePages();
+		goto end_function;
+	}
+	
 	OpenGBRam();
 	
 	
@@ -244,8 +277,7 @@ int8_t API_WriteGBRam(void)
 	ret = 1;
 	
 	//switch bank!
-	if(LoadedBankType != MBC2)
-		SwitchRAMBank(bank);
+	SwitchRAMBank(bank);
 	
 	//disable serial interrupt. we will handle the data, kthxbye
 	//DisableSerialInterrupt();
@@ -274,8 +306,7 @@ int8_t API_WriteGBRam(void)
 			{
 				bank++;
 				i = addr;
-				if(LoadedBankType != MBC2)
-					SwitchRAMBank(bank);	
+				SwitchRAMBank(bank);	
 			}
 			
 			//if we have written everything , on all banks , gtfo. we are done
@@ -336,7 +367,7 @@ end_write_gba:
 	API_ResetGameInfo();
 	return ret;
 }
-int8_t API_WriteRam(int8_t _gbaMode)
+int8_t API_WriteRam(int8_t _gbaMode,uint8_t mode)
 {		
 	API_SetupPins(_gbaMode);
 	int8_t ret = API_GetGameInfo();
@@ -357,118 +388,741 @@ int8_t API_WriteRam(int8_t _gbaMode)
 	}
 	else
 	{
-		return API_WriteGBRam();
+		return API_WriteGBRam(mode);
 	}
 }
-int8_t API_GetRom(void)
+//-------------------------------------
+//		Memory transfer functions
+//-------------------------------------
+//every byte read from the cart is handed to a sink, which sends (or processes) it
+
+//state of the running transfer, so we only switch banks or relatch when needed
+uint16_t _loaded_bank;
+uint16_t _bank_size;
+//offset of the MBC3 clock footer in the save, and the clock as it was latched at the start
+uint32_t _rtc_offset;
+uint8_t _rtc[GB_RTC_REGISTERS];
+uint32_t _next_address;
+uint16_t _block_crc;
+uint32_t _hash_crc;
+uint16_t _sample_crc;
+uint8_t _rle_byte;
+uint8_t _rle_length;
+
+//transmit buffer, drained by the UDRE interrupt so we can read the cart while the USART is shifting out.
+//everything a transfer sends goes through here, and it is flushed at the end of the transfer before anyone uses cprintf again.
+volatile uint8_t _tx_buffer[API_TX_BUFFER_SIZE];
+volatile uint8_t _tx_head = 0;
+volatile uint8_t _tx_tail = 0;
+
+//receive buffer, filled by the serial interrupt during block writes
+volatile uint8_t _rx_buffer[API_RX_BUFFER_SIZE];
+volatile uint8_t _rx_head = 0;
+volatile uint8_t _rx_overflow = 0;
+uint8_t _rx_tail = 0;
+uint8_t _rx_active = 0;
+
+void API_TxNext(void)
+{
+	UDR = _tx_buffer[_tx_tail];
+	_tx_tail = (_tx_tail + 1) & (API_TX_BUFFER_SIZE - 1);
+	if(_tx_tail == _tx_head)
+		UCSRB &= ~_BV(UDRIE);
+}
+ISR(USART_UDRE_vect)
+{
+	API_TxNext();
+}
+void API_TxByte(uint8_t data)
+{
+	uint8_t head = (_tx_head + 1) & (API_TX_BUFFER_SIZE - 1);
+	while(head == _tx_tail)
+	{
+		//buffer is full. if interrupts are off we have to shift it out ourselves
+		if(!(SREG & _BV(SREG_I)) && (UCSRA & _BV(UDRE)))
+			API_TxNext();
+	}
+	
+	_tx_buffer[_tx_head] = data;
+	_tx_head = head;
+	UCSRB |= _BV(UDRIE);
+}
+void API_TxFlush(void)
+{
+	while(_tx_head != _tx_tail)
+	{
+		if(!(SREG & _BV(SREG_I)) && (UCSRA & _BV(UDRE)))
+			API_TxNext();
+	}
+}
+void API_StartTransfer(ROM_TYPE type)
 {
 	SetPin(CTRL_PORT,WD);
 	SetPin(CTRL_PORT,RD);
 	SetPin(CTRL_PORT,CS1);
 	SetPin(CTRL_PORT,CS2);
+	
+	_loaded_bank = 0xFFFF;
+	_next_address = 0xFFFFFFFF;
+	_rtc_offset = 0xFFFFFFFF;
+	
+	if(_gba_cart)
+	{
+		if(type == TYPE_RAM)
+			SwitchBusMode();
+		return;
+	}
+	
+	//reset game cart. this causes all banks & states to reset
+	ResetGBCart();
+	
+	if(type == TYPE_RAM)
+	{
+		uint16_t end_addr = 0xC000;
+		uint8_t banks = 0;
+		GetRamDetails(&end_addr,&banks,gameInfo.RamSize);
+		_bank_size = end_addr - 0xA000;
+		OpenGBRam();
 		
+		//the clock is latched once, so the footer is the time the transfer started.
+		//it follows the ram, so a write without the footer never reaches it
+		if(LoadedMBC.Flags & MBC_FLAG_RTC)
+		{
+			_rtc_offset = (uint32_t)_bank_size * banks;
+			ReadGBRtc(_rtc);
+		}
+	}
+}
+void API_EndTransfer(ROM_TYPE type)
+{
+	API_TxFlush();
+	
 	if(_gba_cart)
-	{			
-		//for dumping we use the GBA's increment reading mode. this saves a alot of cycles and is therefor a lot faster
-		//see the function for more info.
-		uint32_t _readSize = gameInfo.fileSize / 2;		
-		for(uint32_t i = 0; i < _readSize;i++)
+	{
+		if(type == TYPE_RAM)
+			SwitchBusMode();
+		SetPin(CTRL_PORT,CS1);
+		SetPin(CTRL_PORT,CS2);
+		return;
+	}
+	
+	if(type == TYPE_RAM)
+	{
+		CloseGBRam();	
+		ResetGBCart();
+	}
+}
+//reads 'length' bytes, starting at 'offset' of the rom/ram file, and passes them to the sink
+void API_ReadMemory(ROM_TYPE type, uint32_t offset, uint32_t length, api_sink sink)
+{
+	if(_gba_cart && type == TYPE_ROM)
+	{
+		uint32_t address = offset >> 1;
+		//GBA reads 16bit at a time. if we start on an odd offset, drop the first byte
+		uint8_t skip = offset & 0x01;
+		while(length > 0)
 		{
+			//for dumping we use the GBA's increment reading mode. this saves a alot of cycles and is therefor a lot faster
 			//GBA rom's only latch the lower 16bits of the address and increments from that
-			//this means that every 0x10000(0x20000 in file) we need to send an actual read command so it relatches the address
-			uint16_t data = Read24BitIncrementedBytes((i%0x10000) == 0,i);
-			cprintf_char((uint8_t)data & 0xFF);
-			cprintf_char((data >> 8) & 0xFF);
+			//this means that every 0x10000(0x20000 in file) we need to send an actual read command so it relatches the address.
+			//same goes for when we don't continue where the last read stopped
+			uint16_t data = Read24BitIncrementedBytes((address != _next_address) || ((address & 0xFFFF) == 0),address);
+			_next_address = ++address;
+			if(!skip)
+			{
+				sink((uint8_t)data & 0xFF);
+				length--;
+			}
+			skip = 0;
+			if(length > 0)
+			{
+				sink((data >> 8) & 0xFF);
+				length--;
+			}
 		}
-		SetPin(CTRL_PORT,CS1);
+	}
+	else if(_gba_cart)
+	{
+		while(length > 0)
+		{
+			if(gameInfo.CartFlag == GBA_SAVE_FLASH && (offset >> 16) != _loaded_bank)
+			{
+				_loaded_bank = offset >> 16;
+				SwitchFlashRAMBank(_loaded_bank);
+			}
+			
+			//read in chunks of 0x8000 so they fit a 16 bit length, and stay within the flash bank
+			uint16_t chunk = 0x8000 - (offset & 0x7FFF);
+			if(chunk > length)
+				chunk = length;
+			ReadGBARamBlock(offset & 0xFFFF,chunk,sink);
+			offset += chunk;
+			length -= chunk;
+		}
+	}
+	else if(type == TYPE_ROM)
+	{
+		//the mapper's driver knows how its banks are laid out
+		ReadGBRom(offset,length,sink);
 	}
 	else
 	{
-		//reset cart
-		ClearPin(CTRL_PORT,CS2);
-		SetPin(CTRL_PORT,CS2);
-		uint16_t banks = GetAmountOfRomBacks(gameInfo.RomSizeFlag);
-		
-		uint16_t addr = 0;
-		for(uint16_t bank = 1;bank < banks;bank++)
+		//ram is switched per bank size (MBC2 & 2KB ram only have 1 small bank)
+		while(length > 0)
 		{
-			SwitchROMBank(bank);
-			for(;addr < 0x8000;addr++)
+			//the MBC3 clock comes after the ram
+			if(offset >= _rtc_offset)
 			{
-				cprintf_char(ReadGBRomByte(addr));
+				sink(GetGBRtcFooterByte(_rtc,offset - _rtc_offset));
+				offset++;
+				length--;
+				continue;
 			}
-			addr = 0x4000;
-		}			
-	}	
+			
+			uint16_t bank = offset / _bank_size;
+			uint16_t addr = offset % _bank_size;
+			uint16_t chunk = _bank_size - addr;
+			if(chunk > length)
+				chunk = length;
+			if(chunk > _rtc_offset - offset)
+				chunk = _rtc_offset - offset;
+			offset += chunk;
+			length -= chunk;
+			
+			if(bank != _loaded_bank)
+				SwitchRAMBank(bank);
+			_loaded_bank = bank;
+			
+			ReadGBRamBlock(0xA000 + addr,chunk,sink);
+		}
+	}
+}
+void API_SendByte(uint8_t data)
+{
+	API_TxByte(data);
+}
+void API_SendBlockByte(uint8_t data)
+{
+	_block_crc = _crc_xmodem_update(_block_crc,data);
+	API_TxByte(data);
+}
+void API_FlushRle(void)
+{
+	if(_rle_length == 0)
+		return;
 	
-	API_ResetGameInfo();
+	if(_rle_length >= API_RLE_MIN_RUN || _rle_byte == API_RLE_ESCAPE)
+	{
+		API_TxByte(API_RLE_ESCAPE);
+		API_TxByte(_rle_length);
+		API_TxByte(_rle_byte);
+	}
+	else
+	{
+		for(uint8_t i = 0;i < _rle_length;i++)
+			API_TxByte(_rle_byte);
+	}
+	_rle_length = 0;
+}
+//padding & empty saves are mostly long runs of the same byte, so we only hold on to the current run
+void API_SendRleByte(uint8_t data)
+{
+	_block_crc = _crc_xmodem_update(_block_crc,data);
+	
+	if(_rle_length > 0 && data == _rle_byte && _rle_length < 0xFF)
+	{
+		_rle_length++;
+		return;
+	}
+	
+	API_FlushRle();
+	_rle_byte = data;
+	_rle_length = 1;
+}
+//nibble table of the reflected CRC32 (polynomial 0xEDB88320)
+const uint32_t _crc32_table[16] PROGMEM = 
+{
+	0x00000000,0x1DB71064,0x3B6E20C8,0x26D930AC,0x76DC4190,0x6B6B51F4,0x4DB26158,0x5005713C,
+	0xEDB88320,0xF00F9344,0xD6D6A3E8,0xCB61B38C,0x9B64C2B0,0x86D3D2D4,0xA00AE278,0xBDBDF21C
+};
+void API_HashByte(uint8_t data)
+{
+	_hash_crc ^= data;
+	_hash_crc = (_hash_crc >> 4) ^ pgm_read_dword(&_crc32_table[_hash_crc & 0x0F]);
+	_hash_crc = (_hash_crc >> 4) ^ pgm_read_dword(&_crc32_table[_hash_crc & 0x0F]);
+}
+void API_SendHash(ROM_TYPE type,uint32_t offset,uint32_t length)
+{
+	_hash_crc = 0xFFFFFFFF;
+	API_ReadMemory(type,offset,length,API_HashByte);
+	_hash_crc ^= 0xFFFFFFFF;
+	
+	API_TxByte(API_HASH_START);
+	for(int8_t shift = 24;shift >= 0;shift -= 8)
+		API_TxByte((_hash_crc >> shift) & 0xFF);
+	for(int8_t shift = 24;shift >= 0;shift -= 8)
+		API_TxByte((length >> shift) & 0xFF);
+	API_TxByte(API_TASK_FINISHED);
+}
+void API_SampleByte(uint8_t data)
+{
+	_sample_crc = _crc_xmodem_update(_sample_crc,data);
+}
+//cheap signature of a rom bank : the CRC16 of API_MIRROR_SAMPLES bytes spread over the bank
+uint16_t API_GetBankSignature(uint16_t bank)
+{
+	_sample_crc = 0;
+	for(uint8_t i = 0;i < API_MIRROR_SAMPLES;i++)
+	{
+		uint16_t addr = (i * (0x4000 / API_MIRROR_SAMPLES)) + ((i * 37) & 0xFF);
+		API_ReadMemory(TYPE_ROM,((uint32_t)bank << 14) + addr,1,API_SampleByte);
+	}
+	return _sample_crc;
+}
+//carts that declare more rom than they have mirror it. the rom is smaller than declared if the banks at a
+//power of 2 boundary are the same as the banks from 0, up to the next power of 2. 
+//the signatures are read ahead (instead of kept for what was send), so the mirror is never send and we don't need ram for it.
+//returns 1 if the rom ends at the given address
+int8_t API_IsRomMirror(uint32_t address)
+{
+	uint16_t banks = address >> 14;
+	if(_gba_cart || (address & 0x3FFF) || banks < 2 || (banks & (banks - 1)) || address >= gameInfo.fileSize)
+		return 0;
+	
+	for(uint16_t bank = 0;bank < banks && (((uint32_t)banks + bank) << 14) < gameInfo.fileSize;bank++)
+	{
+		if(API_GetBankSignature(bank) != API_GetBankSignature(banks + bank))
+			return 0;
+	}
 	return 1;
 }
-int8_t API_GetRam(void)
+int8_t API_GetInfo(int8_t _gbaMode)
 {
-	//reset game cart. this causes all banks & states to reset
-	if(!_gba_cart)	
+	API_SetupPins(_gbaMode);
+	
+	int8_t ret = API_GetGameInfo();
+	if(ret < 1)
 	{
-		if(LoadedBankType == MBC_NONE || LoadedBankType == MBC_UNSUPPORTED)
-			return ERR_NO_MBC;
-		ClearPin(CTRL_PORT,CS2);
+		API_Send_Abort(API_ABORT_CMD);
+		return ret;
 	}
 	
-	SetPin(CTRL_PORT,WD);
-	SetPin(CTRL_PORT,RD);
-	SetPin(CTRL_PORT,CS1);
-	SetPin(CTRL_PORT,CS2);
+	//a cart without save simply has a ram size of 0
+	uint32_t sizes[2];
+	for(ROM_TYPE type = TYPE_ROM;type <= TYPE_RAM;type++)
+	{
+		if(API_GetMemorySize(type) < 0)
+			gameInfo.fileSize = 0;
+		sizes[type] = gameInfo.fileSize;
+	}
+	
+	uint16_t header_start = _gba_cart?0x00:API_INFO_GB_HEADER_START;
+	uint8_t header_size = _gba_cart?API_INFO_GBA_HEADER_SIZE:API_INFO_GB_HEADER_SIZE;
 	
-	if(_gba_cart)	
+	API_StartTransfer(TYPE_ROM);
+	API_TxByte(API_INFO_START);
+	API_TxByte(API_INFO_SIZE + header_size);
+	_block_crc = 0;
+	API_SendBlockByte(API_GetCartType());
+	API_SendBlockByte(_gba_cart?gameInfo.CartFlag:LoadedMBC.Type);
+	for(uint8_t i = 0;i < 2;i++)
 	{
-		Setup_Pins_8bitMode();
-		uint8_t bank = 0;
-		for( uint32_t i = 0; i < gameInfo.fileSize;i++)
+		for(int8_t shift = 24;shift >= 0;shift -= 8)
+			API_SendBlockByte((sizes[i] >> shift) & 0xFF);
+	}
+	
+	//and the raw header itself, so the host can decode the rest
+	API_ReadMemory(TYPE_ROM,header_start,header_size,API_SendBlockByte);
+	API_TxByte(_block_crc >> 8);
+	API_TxByte(_block_crc & 0xFF);
+	API_EndTransfer(TYPE_ROM);
+	API_ResetGameInfo();
+	return 1;
+}
+//reads the host's reply to our frames. 
+//returns 1 on API_OK, 0 on API_NOK (block is set to the frame the host wants next) and an error on anything else
+int8_t API_GetBlockResponse(uint32_t* block)
+{
+	uint8_t response = Serial_ReadByte();
+	if(response == API_OK)
+		return 1;
+	if(response != API_NOK)
+		return ERR_PACKET_FAILURE;
+	
+	uint16_t seq = Serial_ReadByte() << 8;
+	seq |= Serial_ReadByte();
+	
+	//sequence numbers are only 16bit, but the host can only ask for a frame we already send
+	uint32_t requested = (*block & 0xFFFF0000) | seq;
+	if(requested > *block)
+		requested -= 0x10000;
+	*block = requested;
+	return 0;
+}
+//send the memory as frames of API_BLOCK_SIZE with a sequence number & CRC16.
+//we don't wait for the host after every frame. if the host finds a broken frame it sends API_NOK + sequence number,
+//which we pick up after the frame we are sending and we continue from the requested frame.
+//a broken frame therefor only costs us the frames that were on the line, and not the whole dump.
+//sequence numbers are relative to the start offset of the transfer.
+int8_t API_SendBlocks(ROM_TYPE type,uint8_t mode,uint32_t start,uint32_t size)
+{
+	uint32_t blocks = (size + API_BLOCK_SIZE - 1) / API_BLOCK_SIZE;
+	uint32_t block = 0;
+	int8_t ret = 0;
+	uint8_t rle = (mode & API_TRANSFER_RLE) > 0;
+	uint8_t trim = (mode & API_TRANSFER_TRIM) && type == TYPE_ROM;
+	
+	while(1)
+	{
+		for(;block < blocks;block++)
 		{
-			if((i%0x10000) == 0 && gameInfo.CartFlag == GBA_SAVE_FLASH)
+			uint32_t offset = block * API_BLOCK_SIZE;
+			
+			//stop where the rom starts to mirror, API_BLOCK_END tells the host the size it really is
+			if(trim && API_IsRomMirror(start + offset))
 			{
-				SwitchFlashRAMBank(bank);
-				bank++;
+				size = offset;
+				blocks = block;
+				break;
 			}
 			
-			cprintf_char(ReadGBARamByte(i & 0xFFFF));
+			uint16_t length = API_BLOCK_SIZE;
+			if(size - offset < length)
+				length = size - offset;
+			
+			API_TxByte(rle?API_BLOCK_RLE_START:API_BLOCK_START);
+			API_TxByte((block >> 8) & 0xFF);
+			API_TxByte(block & 0xFF);
+			_block_crc = 0;
+			_rle_length = 0;
+			API_ReadMemory(type,start + offset,length,rle?API_SendRleByte:API_SendBlockByte);
+			API_FlushRle();
+			API_TxByte(_block_crc >> 8);
+			API_TxByte(_block_crc & 0xFF);
+			
+			//did the host complain?
+			if(UCSRA & _BV(RXC))
+			{
+				ret = API_GetBlockResponse(&block);
+				if(ret < 0)
+					return ret;
+				//for loop adds 1 again
+				if(ret == 0)
+					block--;
+			}
 		}
-		Setup_Pins_24bitMode();
+		
+		API_TxByte(API_BLOCK_END);
+		API_TxByte((size >> 24) & 0xFF);
+		API_TxByte((size >> 16) & 0xFF);
+		API_TxByte((size >> 8) & 0xFF);
+		API_TxByte(size & 0xFF);
+		
+		//wait for the host to accept everything, or to ask for the frames it is missing
+		API_TxFlush();
+		ret = API_GetBlockResponse(&block);
+		if(ret != 0)
+			return ret;
 	}
-	else
+}
+//called from the serial interrupt. returns 1 if the byte was buffered for a running block write
+uint8_t API_BufferByte(uint8_t byte)
+{
+	if(!_rx_active)
+		return 0;
+	
+	//a full buffer drops the byte. the page it belonged to is asked for again
+	uint8_t head = (_rx_head + 1) % API_RX_BUFFER_SIZE;
+	if(head == _rx_tail)
 	{
-		//read RAM Address'
-		uint16_t addr = 0xA000;
-		uint16_t end_addr = 0xC000; //actually ends at 0xBFFF
-		uint8_t banks = 0;
+		_rx_overflow = 1;
+		return 1;
+	}
+	
+	_rx_buffer[_rx_head] = byte;
+	_rx_head = head;
+	return 1;
+}
+//reads count bytes of a block write. returns ERR_TIMEOUT if the host stops sending for API_RX_TIMEOUT_MS
+int8_t API_ReadBufferedBytes(uint8_t* buffer, uint8_t count)
+{
+	for(uint8_t i = 0;i < count;i++)
+	{
+		for(uint16_t wait = 0;_rx_head == _rx_tail;wait++)
+		{
+			if(wait >= API_RX_TIMEOUT_MS * 10)
+				return ERR_TIMEOUT;
+			_delay_us(100);
+		}
+		buffer[i] = _rx_buffer[_rx_tail];
+		_rx_tail = (_rx_tail + 1) % API_RX_BUFFER_SIZE;
+	}
+	return 1;
+}
+void API_SendPageResponse(uint8_t response, uint32_t page)
+{
+	cprintf_char(response);
+	cprintf_char((page >> 8) & 0xFF);
+	cprintf_char(page & 0xFF);
+}
+//writes a page to the gb's ram and reads it back. returns 1 if the cart has what we wrote
+int8_t API_WriteGBRamPage(uint32_t offset, uint8_t* data, uint8_t length)
+{
+	//the MBC3 clock comes after the ram, which always ends on a page. it is running, so there is nothing to verify
+	if(offset >= _rtc_offset)
+	{
+		for(uint8_t i = 0;i < length;i++)
+			SetGBRtcFooterByte(_rtc,offset - _rtc_offset + i,data[i]);
+		WriteGBRtc(_rtc);
+		_loaded_bank = 0xFFFF;
+		return 1;
+	}
+	
+	//pages never cross a bank, as the page size fits in every bank size
+	uint16_t bank = offset / _bank_size;
+	uint16_t addr = 0xA000 + (offset % _bank_size);
+	if(bank != _loaded_bank)
+		SwitchRAMBank(bank);
+	_loaded_bank = bank;
+	
+	for(uint8_t i = 0;i < length;i++)
+		WriteGBRamByte(addr+i,data[i]);
+	
+	for(uint8_t i = 0;i < length;i++)
+	{
+		//MBC2 only has the lower 4 bits as data
+		uint8_t diff = (ReadGBRamByte(addr+i) ^ data[i]) & LoadedMBC.RamMask;
+		if(diff)
+			return 0;
+	}
+	return 1;
+}
+//receive the save as pages of API_WRITE_PAGE_SIZE : API_BLOCK_START, sequence number, data, CRC16.
+//every page is written & read back before we answer API_OK + seq, or API_NOK + seq to get it (and everything after it) again.
+//while we write, the next pages are buffered by the serial interrupt.
+//pages we don't want are skipped as a whole, so between pages only API_BLOCK_START or the host's API_ABORT is expected.
+int8_t API_ReceivePages(void)
+{
+	uint32_t pages = (gameInfo.fileSize + API_WRITE_PAGE_SIZE - 1) / API_WRITE_PAGE_SIZE;
+	uint32_t page = 0;
+	uint8_t nok_send = 0;
+	uint8_t data[API_WRITE_PAGE_SIZE];
+	uint8_t header[3];
+	uint8_t timed_out = 0;
+	int8_t ret = 1;
+	
+	API_StartTransfer(TYPE_RAM);
+	_rx_tail = _rx_head;
+	_rx_overflow = 0;
+	_rx_active = 1;
+	EnableSerialInterrupt();
+	
+	//send the Start, we are ready for the pages!
+	cprintf_char(API_TASK_START);
+	
+	while(page < pages)
+	{
+		ret = API_ReadBufferedBytes(header,1);
+		if(ret < 0 && !timed_out)
+		{
+			//nothing is coming. if we lost track of a page the host waits on us, so ask for it once more
+			API_SendPageResponse(API_NOK,page);
+			nok_send = 1;
+			timed_out = 1;
+			continue;
+		}
+		if(ret < 0)
+			break;
+		if(header[0] == API_ABORT)
+		{
+			ret = ERR_PACKET_FAILURE;
+			break;
+		}
+		if(header[0] != API_BLOCK_START)
+			continue;
 		
-		int8_t ret = GetRamDetails(&end_addr,&banks,gameInfo.RamSize);
+		ret = API_ReadBufferedBytes(&header[1],2);
+		if(ret < 0)
+			break;
+		uint16_t seq = (header[1] << 8) | header[2];
+		uint32_t received = page + (int16_t)(seq - (uint16_t)page);
+		if(received >= pages)
+		{
+			//a byte in the data that looked like a start
+			continue;
+		}
+		
+		uint8_t length = API_WRITE_PAGE_SIZE;
+		if(gameInfo.fileSize - (received * API_WRITE_PAGE_SIZE) < length)
+			length = gameInfo.fileSize - (received * API_WRITE_PAGE_SIZE);
 		
+		ret = API_ReadBufferedBytes(data,length);
 		if(ret < 0)
-			return ERR_NO_SAVE;
+			break;
+		ret = API_ReadBufferedBytes(header,2);
+		if(ret < 0)
+			break;
 		
-		OpenGBRam();
-
-		for(uint8_t bank = 0;bank < banks;bank++)
+		if(received != page)
 		{
-			//if we aren't dealing with MBC2, set bank to 0!
-			if(LoadedBankType != MBC2)
-				SwitchRAMBank(bank);	
-			
-			for(uint16_t i = addr;i< end_addr ;i++)
+			//a page past the one we want means it got lost. ask for it again
+			//a page before it was still underway when we asked
+			if(!nok_send && received > page)
 			{
-				cprintf_char(ReadGBRamByte(i));
-				//asm("nop");	
+				API_SendPageResponse(API_NOK,page);
+				nok_send = 1;
 			}
+			continue;
 		}
 		
-		CloseGBRam();	
-		ClearPin(CTRL_PORT,CS2);
+		uint16_t crc = 0;
+		for(uint8_t i = 0;i < length;i++)
+			crc = _crc_xmodem_update(crc,data[i]);
+		uint16_t recv_crc = (header[0] << 8) | header[1];
+		
+		//bytes were dropped while the buffer was full. whatever is in it can't be trusted, start over from this page
+		if(_rx_overflow)
+		{
+			_rx_tail = _rx_head;
+			_rx_overflow = 0;
+			recv_crc = ~crc;
+		}
+		
+		if(crc == recv_crc && API_WriteGBRamPage(page * API_WRITE_PAGE_SIZE,data,length) > 0)
+		{
+			API_SendPageResponse(API_OK,page);
+			page++;
+			nok_send = 0;
+			timed_out = 0;
+		}
+		else
+		{
+			API_SendPageResponse(API_NOK,page);
+			nok_send = 1;
+		}
 	}
 	
-	SetPin(CTRL_PORT,CS2);
+	DisableSerialInterrupt();
+	_rx_active = 0;
+	API_EndTransfer(TYPE_RAM);
+	
+	if(ret > 0)
+		cprintf_char(API_TASK_FINISHED);
+	return ret;
+}
+int8_t API_GetRom(uint8_t mode,uint32_t offset,uint32_t length)
+{
+	int8_t ret = 1;
+	API_StartTransfer(TYPE_ROM);
+	
+	if(mode & API_TRANSFER_HASH)
+		API_SendHash(TYPE_ROM,offset,length);
+	else if(mode & (API_TRANSFER_BLOCK | API_TRANSFER_RLE))
+		ret = API_SendBlocks(TYPE_ROM,mode,offset,length);
+	else
+		API_ReadMemory(TYPE_ROM,offset,length,API_SendByte);
+	
+	API_EndTransfer(TYPE_ROM);
 	API_ResetGameInfo();
-	return 1;
+	return ret;
+}
+int8_t API_GetRam(uint8_t mode,uint32_t offset,uint32_t length)
+{
+	if(!_gba_cart && !(LoadedMBC.Flags & MBC_FLAG_RAM))
+		return ERR_NO_MBC;
+	
+	int8_t ret = 1;
+	API_StartTransfer(TYPE_RAM);
+	
+	if(mode & API_TRANSFER_HASH)
+		API_SendHash(TYPE_RAM,offset,length);
+	else if(mode & (API_TRANSFER_BLOCK | API_TRANSFER_RLE))
+		ret = API_SendBlocks(TYPE_RAM,mode,offset,length);
+	else
+		API_ReadMemory(TYPE_RAM,offset,length,API_SendByte);
+	
+	API_EndTransfer(TYPE_RAM);
+	API_ResetGameInfo();
+	return ret;
+}
+int8_t API_SetBaudRate(uint32_t baud)
+{
+	//with U2X the USART runs at F_CPU / (8 * (UBRR+1))
+	if(baud == 0 || baud > F_CPU / 8)
+	{
+		cprintf_char(API_NOK);
+		return 0;
+	}
+	
+	uint32_t ubrr = ((F_CPU + (baud * 4)) / (baud * 8)) - 1;
+	uint32_t actual = F_CPU / ((ubrr + 1) * 8);
+	uint32_t error = (actual > baud)?(actual - baud):(baud - actual);
+	if(ubrr > 0x0FFF || error * 100 > baud * API_BAUD_MAX_ERROR)
+	{
+		cprintf_char(API_NOK);
+		return 0;
+	}
+	
+	uint8_t old_ubrrh = UBRRH;
+	uint8_t old_ubrrl = UBRRL;
+	uint8_t old_u2x = UCSRA & _BV(U2X);
+	
+	//let the OK go out completely before switching
+	UCSRA = old_u2x | _BV(TXC);
+	cprintf_char(API_OK);
+	while(!(UCSRA & _BV(TXC)));
+	
+	UBRRH = (ubrr >> 8) & 0x0F;
+	UBRRL = ubrr & 0xFF;
+	UCSRA = _BV(U2X);
+	while(UCSRA & _BV(RXC))
+		(void)UDR;
+	
+	//wait for the host's probe at the new rate
+	for(uint16_t i = 0;i < API_BAUD_PROBE_TIMEOUT * 10 && !(UCSRA & _BV(RXC));i++)
+		_delay_us(100);
+	
+	if((UCSRA & _BV(RXC)) && UDR == API_HANDSHAKE_REQUEST)
+	{
+		cprintf_char(API_HANDSHAKE_ACCEPT);
+		return 1;
+	}
+	
+	//no link, back to what we had
+	UBRRH = old_ubrrh;
+	UBRRL = old_ubrrl;
+	UCSRA = old_u2x;
+	return 0;
+}
+void API_Send_Handshake(uint8_t autoDetect)
+{
+	cprintf_char(API_HANDSHAKE_ACCEPT);
+	cprintf_char(autoDetect);
+	cprintf_char(API_PROTOCOL_VERSION);
+	cprintf_char(API_HANDSHAKE_PAYLOAD_SIZE);
+	
+#if defined(GPIO_EXTENDER_MODE)
+	cprintf_char(API_BUILD_GPIO_EXTENDER);
+#elif defined(SHIFTING_MODE)
+	cprintf_char(API_BUILD_SHIFTING);
+#else
+	cprintf_char(API_BUILD_NORMAL);
+#endif
+	cprintf_char(SIGNATURE_1);
+	cprintf_char(SIGNATURE_2);
+	for(int8_t shift = 24;shift >= 0;shift -= 8)
+		cprintf_char((F_CPU >> shift) & 0xFF);
+	//with U2X
+	for(int8_t shift = 24;shift >= 0;shift -= 8)
+		cprintf_char(((F_CPU / 8) >> shift) & 0xFF);
+	cprintf_char(API_CAPABILITIES >> 8);
+	cprintf_char(API_CAPABILITIES & 0xFF);
+	cprintf_char(API_BLOCK_SIZE >> 8);
+	cprintf_char(API_BLOCK_SIZE & 0xFF);
+	cprintf_char(API_CMD_MAX_PARAMS);
+	cprintf_char(API_WRITE_PAGE_SIZE);
+	cprintf_char(API_BAUD_PROBE_TIMEOUT >> 8);
+	cprintf_char(API_BAUD_PROBE_TIMEOUT & 0xFF);
 }
 void API_Send_Abort(uint8_t type)
 {
@@ -497,7 +1151,17 @@ void API_Send_Size(void)
 	return;
 }
 
-void API_Send_Cart_Type(void)
+//tells the host the ram transfer ends with the clock footer
+void API_Send_Rtc(void)
+{
+	if(_gba_cart || !(LoadedMBC.Flags & MBC_FLAG_RTC))
+		return;
+	
+	cprintf_char(API_RTC_START);
+	cprintf_char(GB_RTC_SIZE);
+	cprintf_char(API_RTC_END);
+}
+uint8_t API_GetCartType(void)
 {
 	uint8_t toSend = 0xFF;
 	
@@ -519,7 +1183,11 @@ void API_Send_Cart_Type(void)
 		}
 	}
 	
+	return toSend;
+}
+void API_Send_Cart_Type(void)
+{
 	cprintf_char(API_GB_CART_TYPE_START);
-	cprintf_char(toSend);
+	cprintf_char(API_GetCartType());
 	cprintf_char(API_GB_CART_TYPE_END);
 }
\ No newline at end of file
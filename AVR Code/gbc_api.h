@@ -16,14 +16,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #ifndef _GBC_API_H_
 #define _GBC_API_H_
 
-//API Commands!
-#define API_READ_ROM "API_READ_ROM"
-#define API_READ_ROM_SIZE 12
-#define API_READ_RAM "API_READ_RAM"
-#define API_READ_RAM_SIZE 12
-#define API_WRITE_RAM "API_WRITE_RAM"
-#define API_WRITE_RAM_SIZE 13
-
 #define API_GB_CART_TYPE_START 0x76
 #define API_GB_CART_TYPE_END 0x77
 #define API_GBC_ONLY 0x78
@@ -35,6 +27,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define API_GAMENAME_END 0x87
 #define API_FILESIZE_START 0x96
 #define API_FILESIZE_END 0x97
+//GB ram transfers of MBC3 timer carts end with the clock footer. the header then has API_RTC_START, footer size, API_RTC_END
+#define API_RTC_START 0xA6
+#define API_RTC_END 0xA7
 
 
 #define API_OK 0x10
@@ -46,21 +41,114 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define API_HANDSHAKE_REQUEST 0x017
 #define API_HANDSHAKE_ACCEPT 0x06
 
+//the handshake is answered with API_HANDSHAKE_ACCEPT, auto detect byte, protocol version, payload size & payload :
+//build mode(1), MCU signature(2), F_CPU(4), max baud rate(4), capabilities(2), max frame size(2),
+//max command parameters(1), write page size(1), baud probe timeout in ms(2)
+//hosts should ignore payload bytes they don't know, newer versions only append to it.
+#define API_PROTOCOL_VERSION 0x02
+#define API_HANDSHAKE_PAYLOAD_SIZE 19
+#define API_BUILD_NORMAL 0x00
+#define API_BUILD_SHIFTING 0x01
+#define API_BUILD_GPIO_EXTENDER 0x02
+
+//capabilities
+#define API_CAP_BLOCK 0x0001
+#define API_CAP_RLE 0x0002
+#define API_CAP_HASH 0x0004
+#define API_CAP_RESUME 0x0008
+#define API_CAP_PAGED_WRITE 0x0010
+#define API_CAP_SET_BAUD 0x0020
+#define API_CAP_INFO 0x0040
+#define API_CAP_TRIM 0x0080
+#define API_CAP_RTC 0x0100
+#define API_CAPABILITIES (API_CAP_BLOCK | API_CAP_RLE | API_CAP_HASH | API_CAP_RESUME | API_CAP_PAGED_WRITE | API_CAP_SET_BAUD | API_CAP_INFO | API_CAP_TRIM | API_CAP_RTC)
+
 #define API_TASK_START 0x20
 #define API_TASK_FINISHED 0x21
 #define API_CART_MODE_AUTO 0x22
 #define API_CART_MODE_GB 0x23
 #define API_CART_MODE_GBA 0x24
 
-#define API_MODE_READ_ROM 0xD0;
-#define API_MODE_READ_RAM 0xD1;
-#define API_MODE_WRITE_RAM 0xD2;
+//API Commands!
+//commands are send as binary frames : opcode, parameter length, parameters, checksum.
+//parameters are big endian & optional, the ones left out are 0. the checksum is the XOR of all other bytes in the frame.
+//API_CMD_READ_ROM/RAM : transfer mode(1 byte), start offset(4 bytes), length(4 bytes)
+//API_CMD_WRITE_RAM : transfer mode(1 byte)
+//API_CMD_SET_BAUD : baud rate(4 bytes)
+//API_CMD_GET_INFO : no parameters
+#define API_CMD_READ_ROM 0xD0
+#define API_CMD_READ_RAM 0xD1
+#define API_CMD_WRITE_RAM 0xD2
+#define API_CMD_SET_BAUD 0xD3
+#define API_CMD_GET_INFO 0xD4
+#define API_CMD_COUNT 5
+#define API_CMD_MAX_PARAMS 0x10
 
 #define API_ABORT 0xF0
 #define API_ABORT_ERROR 0xF1
 #define API_ABORT_CMD 0xF2
 #define API_ABORT_PACKET 0xF3
 
+//block transfer mode. the memory is send in frames of API_BLOCK_SIZE bytes :
+//API_BLOCK_START, sequence number(lower 16 bits), data, CRC16(2 bytes, XMODEM)
+//the transfer is closed with API_BLOCK_END followed by the transfered size(4 bytes)
+#define API_BLOCK_START 0x30
+#define API_BLOCK_END 0x31
+#define API_BLOCK_RLE_START 0x32
+#define API_BLOCK_SIZE 0x100
+
+//run length encoded frames start with API_BLOCK_RLE_START. the data is send as is, 
+//except for runs(and the escape byte itself) which are send as API_RLE_ESCAPE, length, byte.
+//the CRC is that of the decoded data
+#define API_RLE_ESCAPE 0xA5
+#define API_RLE_MIN_RUN 4
+
+//transfer modes, given as parameter of the read commands
+#define API_TRANSFER_RAW 0x00
+#define API_TRANSFER_BLOCK 0x01
+#define API_TRANSFER_RLE 0x02 //implies API_TRANSFER_BLOCK
+#define API_TRANSFER_HASH 0x04 //overrides the others
+#define API_TRANSFER_TRIM 0x08 //GB rom in block mode : stop where the rom starts to mirror itself
+#define API_TRANSFER_NO_RTC 0x10 //GB ram write : only the ram, the clock of MBC3 timer carts is left alone
+
+//hash mode : instead of the memory we only send API_HASH_START, its CRC32(4 bytes, as used by zip) & the hashed size(4 bytes)
+#define API_HASH_START 0x33
+
+//the read commands also take an optional start offset & length, to resume a broken dump.
+//a length of 0 reads till the end. the header still reports the full size, block numbers start at 0 from the offset
+//and API_BLOCK_END reports the amount of bytes sent.
+
+//carts that declare more rom than they have mirror it. with API_TRANSFER_TRIM we compare the signature (CRC16 of
+//API_MIRROR_SAMPLES bytes) of the banks at every power of 2 with those from bank 0, and stop the dump if they mirror.
+//API_BLOCK_END then reports the smaller size
+#define API_MIRROR_SAMPLES 0x40
+
+//block write mode. the host sends the save in pages of API_WRITE_PAGE_SIZE, framed the same as the block transfer.
+//every page is answered with API_OK or API_NOK + sequence number(2 bytes) after it was written & verified.
+//the received pages are buffered while we write, so the host can keep a few pages in flight.
+#define API_WRITE_PAGE_SIZE 0x40
+#define API_RX_BUFFER_SIZE 0x100
+//the host has this long to send the next byte of a block write, or it is considered gone
+#define API_RX_TIMEOUT_MS 1000
+
+//size of the transmit buffer used during transfers. has to be a power of 2
+#define API_TX_BUFFER_SIZE 0x40
+
+//cart info, send as one frame without starting a dump : API_INFO_START, payload size, payload, CRC16(XMODEM) of the payload.
+//payload : cart type(API_GBC_ONLY,...), MBC type (GB) or save type (GBA), rom size(4 bytes), ram size(4 bytes)
+//followed by the raw cart header (0x100 - 0x14F on GB, 0x00 - 0xBF on GBA)
+#define API_INFO_START 0x34
+#define API_INFO_SIZE 0x0A
+#define API_INFO_GB_HEADER_START 0x100
+#define API_INFO_GB_HEADER_SIZE 0x50
+#define API_INFO_GBA_HEADER_SIZE 0xC0
+
+//baud rate negotiation. we answer API_CMD_SET_BAUD with API_NOK if our clock can't get within API_BAUD_MAX_ERROR % of the rate.
+//otherwise we answer API_OK and switch. the host then has API_BAUD_PROBE_TIMEOUT ms to send API_HANDSHAKE_REQUEST at the new rate,
+//which we answer with API_HANDSHAKE_ACCEPT. if the probe doesn't come (or is broken) we go back to the old rate.
+#define API_BAUD_MAX_ERROR 2
+#define API_BAUD_PROBE_TIMEOUT 200
+
 typedef uint8_t ROM_TYPE;
 #define TYPE_ROM 0
 #define TYPE_RAM 1
@@ -79,17 +167,28 @@ void API_Init(void);
 void API_SetupPins(int8_t _gb_mode);
 int8_t API_GetGameInfo(void);
 void API_ResetGameInfo(void);
-int8_t API_Get_Memory(ROM_TYPE type,int8_t _gbaMode);
+int8_t API_Get_Memory(ROM_TYPE type,int8_t _gbaMode,uint8_t mode,uint32_t offset,uint32_t length);
 int8_t API_WaitForOK(void);
-int8_t API_WriteRam(int8_t _gbaMode);
+int8_t API_WriteRam(int8_t _gbaMode,uint8_t mode);
+uint8_t API_BufferByte(uint8_t byte);
+int8_t API_SetBaudRate(uint32_t baud);
+int8_t API_GetInfo(int8_t _gbaMode);
+void API_Send_Handshake(uint8_t autoDetect);
 
 
 //side functions that can be used if the API is used in a custom manor
-int8_t API_GetRom(void); //gets called by API_Get_Memory
-int8_t API_GetRam(void); //gets called by API_Get_Memory
+int8_t API_GetRom(uint8_t mode,uint32_t offset,uint32_t length); //gets called by API_Get_Memory
+int8_t API_GetRam(uint8_t mode,uint32_t offset,uint32_t length); //gets called by API_Get_Memory
+int8_t API_ReceivePages(void); //gets called by API_WriteRam
+void API_TxByte(uint8_t data);
+void API_SendByte(uint8_t data);
+void API_TxFlush(void); //needs to be called before using cprintf again
+int8_t API_GetMemorySize(ROM_TYPE type);
+uint8_t API_GetCartType(void);
 void API_Send_Abort(uint8_t type);
 void API_Send_Name(void);
 void API_Send_Cart_Type(void);
 void API_Send_Size(void);
+void API_Send_Rtc(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,11 @@
+#ifndef _SIM_AVR_INTERRUPT_H_
+#define _SIM_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+//interrupts never fire in the simulation, code that depends on them runs its polling path (SREG_I is never set)
+#define ISR(vector) void vector(void); void vector(void)
+#define sei()
+#define cli()
+
+#endif
@@ -0,0 +1,107 @@
+/*
+gbsim - host build of the GB/C/A dumper code, running against a simulated cartridge. avr/io.h replacement
+Copyright (C) 2018-2019  DacoTaco
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation version 2.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef _SIM_AVR_IO_H_
+#define _SIM_AVR_IO_H_
+
+#include <stdint.h>
+#include "sim_io.h"
+
+//the registers are plain variables. the PINx registers are what the simulated cart puts on the bus
+extern volatile uint8_t PORTA,PORTB,PORTC,PORTD;
+extern volatile uint8_t DDRA,DDRB,DDRC,DDRD;
+#define PINA sim_ReadPin(&PORTA)
+#define PINB sim_ReadPin(&PORTB)
+#define PINC sim_ReadPin(&PORTC)
+#define PIND sim_ReadPin(&PORTD)
+
+extern volatile uint8_t UCSRA,UCSRB,UCSRC,UDR,UBRRH,UBRRL;
+extern volatile uint8_t SPDR,SPSR,SPCR;
+extern volatile uint8_t TCCR0,TCNT0,TIFR,TCCR1B;
+extern volatile uint16_t TCNT1;
+extern volatile uint8_t SREG;
+
+#define _BV(b) (1 << (b))
+#define _SFR_IO_ADDR(x) 0
+
+//atmega32
+#define SIGNATURE_0 0x1E
+#define SIGNATURE_1 0x95
+#define SIGNATURE_2 0x02
+
+#define PA0 0
+#define PA1 1
+#define PA2 2
+#define PA3 3
+#define PA4 4
+#define PA5 5
+#define PA6 6
+#define PA7 7
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+#define PC7 7
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+
+#define RXC 7
+#define TXC 6
+#define UDRE 5
+#define FE 4
+#define DOR 3
+#define PE 2
+#define U2X 1
+#define RXCIE 7
+#define TXCIE 6
+#define UDRIE 5
+#define RXEN 4
+#define TXEN 3
+#define URSEL 7
+#define UCSZ1 2
+#define UCSZ0 1
+
+#define SPIF 7
+#define SPE 6
+#define DORD 5
+#define MSTR 4
+#define CPOL 3
+#define CPHA 2
+#define SPR1 1
+#define SPR0 0
+#define SPI2X 0
+
+#define CS10 0
+#define TOV1 2
+#define SREG_I 7
+
+#endif
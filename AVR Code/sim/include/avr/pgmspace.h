@@ -0,0 +1,15 @@
+#ifndef _SIM_AVR_PGMSPACE_H_
+#define _SIM_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(x) (*(const uint8_t*)(x))
+#define pgm_read_word(x) (*(const uint16_t*)(x))
+#define pgm_read_dword(x) (*(const uint32_t*)(x))
+#define pgm_read_ptr(x) (*(void* const*)(x))
+#define memcpy_P(d,s,n) memcpy(d,s,n)
+
+#endif
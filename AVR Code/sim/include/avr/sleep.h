@@ -0,0 +1,7 @@
+#ifndef _SIM_AVR_SLEEP_H_
+#define _SIM_AVR_SLEEP_H_
+
+#define set_sleep_mode(x)
+#define sleep_mode()
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef _SIM_AVR_WDT_H_
+#define _SIM_AVR_WDT_H_
+
+#define wdt_enable(x)
+#define wdt_disable()
+#define wdt_reset()
+
+#endif
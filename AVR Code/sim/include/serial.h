@@ -0,0 +1,15 @@
+#ifndef _SIM_SERIAL_H_
+#define _SIM_SERIAL_H_
+
+#include <stdint.h>
+
+//the serial library, everything send to the host is counted and dropped
+void initConsole(void);
+void cprintf(const char* str);
+void cprintf_char(char c);
+uint8_t Serial_ReadByte(void);
+void EnableSerialInterrupt(void);
+void DisableSerialInterrupt(void);
+void setSerialRecvCallback(void (*callback)(char));
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef _SIM_UTIL_DELAY_H_
+#define _SIM_UTIL_DELAY_H_
+
+#include "sim_io.h"
+
+//delays don't wait, they are added to the cycle count
+#define _delay_us(us) sim_Delay((uint32_t)((us) * (F_CPU / 1000000UL)))
+#define _delay_ms(ms) sim_Delay((uint32_t)((ms) * (F_CPU / 1000UL)))
+
+#endif
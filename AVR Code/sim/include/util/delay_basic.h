@@ -0,0 +1,17 @@
+#ifndef _SIM_UTIL_DELAY_BASIC_H_
+#define _SIM_UTIL_DELAY_BASIC_H_
+
+#include <stdint.h>
+#include "sim_io.h"
+
+//same cycle counts as avr-libc : 3 cycles per count, 4 for the 16 bit loop. a count of 0 is 256/65536
+static inline void _delay_loop_1(uint8_t count)
+{
+	sim_Delay((count == 0 ? 256UL : count) * 3);
+}
+static inline void _delay_loop_2(uint16_t count)
+{
+	sim_Delay((count == 0 ? 65536UL : count) * 4);
+}
+
+#endif
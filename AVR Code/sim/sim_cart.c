@@ -0,0 +1,528 @@
+/*
+gbsim - host build of the GB/C/A dumper code, running against a simulated cartridge. the cartridge model
+Copyright (C) 2018-2019  DacoTaco
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation version 2.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include "gb_pins.h"
+#include "sim_io.h"
+#include "sim_cart.h"
+
+//cart models, in the same style as the MBC defines of 8bit_cart.h. kept separate so the model doesn't share the firmware's mistakes
+#define SIM_MBC_NONE 0
+#define SIM_MBC1 1
+#define SIM_MBC2 2
+#define SIM_MBC3 3
+#define SIM_MBC5 5
+
+//the GBA eeprom sends 4 junk bits before the 64 data bits
+#define EEPROM_OUT_BITS 68
+
+typedef struct _sim_cart
+{
+	uint8_t gba;
+	uint8_t* rom;
+	uint32_t rom_size;
+	uint8_t save[SIM_MAX_SAVE_SIZE];
+	uint32_t save_size;
+	
+	//GB mapper state
+	uint8_t mbc;
+	uint8_t rom_reg;
+	uint8_t bank_hi;
+	uint8_t ram_bank;
+	uint8_t ram_enabled;
+	uint8_t mbc1_mode;
+	uint8_t mbc1m;
+	uint8_t rtc[5];
+	uint8_t rtc_latched[5];
+	uint8_t rtc_latch;
+	
+	//GBA state
+	uint8_t save_type;
+	uint32_t address;
+	uint8_t flash_state;
+	uint8_t flash_cmd;
+	uint8_t flash_erase;
+	uint8_t flash_id;
+	uint8_t flash_bank;
+	uint8_t eeprom_in[2 + 14 + 64 + 1];
+	uint8_t eeprom_count;
+	uint8_t eeprom_out[EEPROM_OUT_BITS];
+	uint8_t eeprom_pos;
+	uint8_t eeprom_reading;
+} sim_cart;
+
+sim_cart cart;
+
+#define PIN_LOW(port,pin) (((port) & (1 << (pin))) == 0)
+#define FELL(pin) (!PIN_LOW(old_ctrl,pin) && PIN_LOW(new_ctrl,pin))
+#define ROSE(pin) (PIN_LOW(old_ctrl,pin) && !PIN_LOW(new_ctrl,pin))
+
+int8_t sim_LoadRom(const char* filename, int8_t gba)
+{
+	FILE* file = fopen(filename,"rb");
+	if(file == NULL)
+		return -1;
+	
+	fseek(file,0,SEEK_END);
+	long size = ftell(file);
+	fseek(file,0,SEEK_SET);
+	if(size <= 0 || size > 0x2000000)
+	{
+		fclose(file);
+		return -1;
+	}
+	
+	uint8_t* rom = malloc(size);
+	if(rom == NULL || fread(rom,1,size,file) != (size_t)size)
+	{
+		free(rom);
+		fclose(file);
+		return -1;
+	}
+	fclose(file);
+	return sim_SetRom(rom,(uint32_t)size,gba);
+}
+//takes ownership of the (malloc'd) rom image
+int8_t sim_SetRom(uint8_t* rom, uint32_t size, int8_t gba)
+{
+	if(rom == NULL || size == 0)
+		return -1;
+	
+	free(cart.rom);
+	memset(&cart,0,sizeof(cart));
+	cart.rom = rom;
+	cart.rom_size = size;
+	cart.gba = gba;
+	
+	//unwritten save memory reads as 0xFF, like fresh flash
+	memset(cart.save,0xFF,sizeof(cart.save));
+	if(gba || cart.rom_size < 0x150)
+		return 1;
+	
+	uint8_t type = cart.rom[0x147];
+	if(type >= 0x01 && type <= 0x03)
+		cart.mbc = SIM_MBC1;
+	else if(type == 0x05 || type == 0x06)
+		cart.mbc = SIM_MBC2;
+	else if(type >= 0x0F && type <= 0x13)
+		cart.mbc = SIM_MBC3;
+	else if(type >= 0x19 && type <= 0x1E)
+		cart.mbc = SIM_MBC5;
+	else
+		cart.mbc = SIM_MBC_NONE;
+	
+	//clock carts start with some time on the clock, so a dump that misses it shows. the simulated clock doesn't run
+	if(type == 0x0F || type == 0x10)
+	{
+		const uint8_t rtc[5] = { 12, 34, 5, 0xA7, 0x01 };
+		memcpy(cart.rtc,rtc,sizeof(cart.rtc));
+	}
+	
+	//MBC1M multicarts are wired differently, which shows by the logo of the 2nd game in bank 0x10
+	if(cart.mbc == SIM_MBC1 && cart.rom_size == 0x100000 && memcmp(&cart.rom[0x104],&cart.rom[0x40104],0x30) == 0)
+		cart.mbc1m = 1;
+	
+	const uint32_t ram_sizes[] = { 0, 0x800, 0x2000, 0x8000, 0x20000, 0x10000 };
+	if(cart.mbc == SIM_MBC2)
+		cart.save_size = 0x200;
+	else if(cart.rom[0x149] < sizeof(ram_sizes) / sizeof(ram_sizes[0]))
+		cart.save_size = ram_sizes[cart.rom[0x149]];
+	
+	return 1;
+}
+int8_t sim_SetGBASave(uint8_t type, uint32_t size)
+{
+	if(size > SIM_MAX_SAVE_SIZE || (type != SIM_SAVE_NONE && size == 0))
+		return -1;
+	
+	cart.save_type = type;
+	cart.save_size = (type == SIM_SAVE_NONE)? 0 : size;
+	return 1;
+}
+int8_t sim_LoadSave(const char* filename)
+{
+	FILE* file = fopen(filename,"rb");
+	if(file == NULL)
+		return -1;
+	
+	size_t read = fread(cart.save,1,cart.save_size,file);
+	fclose(file);
+	return read > 0 ? 1 : -1;
+}
+const uint8_t* sim_GetRom(uint32_t* size)
+{
+	*size = cart.rom_size;
+	return cart.rom;
+}
+const uint8_t* sim_GetSave(uint32_t* size)
+{
+	*size = cart.save_size;
+	return cart.save;
+}
+const uint8_t* sim_GetRtc(void)
+{
+	return cart.rtc;
+}
+
+//GB
+//--------------------------------
+uint16_t _BusAddress(void)
+{
+	return ((uint16_t)ADDR_PORT2 << 8) | ADDR_PORT1;
+}
+uint16_t _GBRomBank(void)
+{
+	uint16_t bank = cart.rom_reg;
+	switch(cart.mbc)
+	{
+		case SIM_MBC1:
+			bank &= 0x1F;
+			if(bank == 0)
+				bank = 1;
+			//MBC1M doesn't have bit 4 of the register wired
+			if(cart.mbc1m)
+				return (bank & 0x0F) | (cart.bank_hi << 4);
+			return bank | (cart.bank_hi << 5);
+		case SIM_MBC2:
+			bank &= 0x0F;
+			return bank == 0 ? 1 : bank;
+		case SIM_MBC3:
+			bank &= 0x7F;
+			return bank == 0 ? 1 : bank;
+		case SIM_MBC5:
+			return bank | (cart.bank_hi << 8);
+		default:
+			return 1;
+	}
+}
+uint32_t _GBRamOffset(uint16_t address)
+{
+	uint8_t bank = cart.ram_bank;
+	if(cart.mbc == SIM_MBC1)
+		bank = cart.mbc1_mode ? cart.bank_hi : 0;
+	if(cart.mbc == SIM_MBC2)
+		return address & 0x1FF;
+	return ((uint32_t)bank * 0x2000 + (address & 0x1FFF)) % cart.save_size;
+}
+//returns 1 if the cart drives the data bus for this address
+uint8_t _GBRead(uint16_t address, uint8_t* value)
+{
+	if(address < 0x8000)
+	{
+		uint32_t bank = 0;
+		if(address >= 0x4000)
+			bank = _GBRomBank();
+		else if(cart.mbc == SIM_MBC1 && cart.mbc1_mode)
+			bank = cart.bank_hi << (cart.mbc1m ? 4 : 5);
+		
+		*value = cart.rom[(bank * 0x4000 + (address & 0x3FFF)) % cart.rom_size];
+		return 1;
+	}
+	
+	if(address < 0xA000 || address >= 0xC000 || !PIN_LOW(CTRL_PORT,CS1))
+		return 0;
+	
+	if(!cart.ram_enabled)
+		*value = 0xFF;
+	else if(cart.mbc == SIM_MBC3 && cart.ram_bank >= 0x08 && cart.ram_bank <= 0x0C)
+		*value = cart.rtc_latched[cart.ram_bank - 0x08];
+	else if(cart.save_size == 0)
+		*value = 0xFF;
+	else if(cart.mbc == SIM_MBC2)
+		*value = 0xF0 | cart.save[_GBRamOffset(address)];
+	else
+		*value = cart.save[_GBRamOffset(address)];
+	return 1;
+}
+void _GBWrite(uint16_t address, uint8_t data)
+{
+	if(address >= 0xA000 && address < 0xC000)
+	{
+		if(!PIN_LOW(CTRL_PORT,CS1) || !cart.ram_enabled)
+			return;
+		if(cart.mbc == SIM_MBC3 && cart.ram_bank >= 0x08 && cart.ram_bank <= 0x0C)
+			cart.rtc[cart.ram_bank - 0x08] = data;
+		else if(cart.mbc == SIM_MBC2)
+			cart.save[_GBRamOffset(address)] = data & 0x0F;
+		else if(cart.save_size > 0)
+			cart.save[_GBRamOffset(address)] = data;
+		return;
+	}
+	if(address >= 0x8000)
+		return;
+	
+	switch(cart.mbc)
+	{
+		case SIM_MBC2:
+			//bit 8 of the address selects between the ram enable & the rom bank
+			if(address >= 0x4000)
+				break;
+			if(address & 0x100)
+				cart.rom_reg = data;
+			else
+				cart.ram_enabled = (data & 0x0F) == 0x0A;
+			break;
+		case SIM_MBC1:
+		case SIM_MBC3:
+		case SIM_MBC5:
+			if(address < 0x2000)
+				cart.ram_enabled = (data & 0x0F) == 0x0A;
+			else if(cart.mbc == SIM_MBC5 && address >= 0x3000 && address < 0x4000)
+				cart.bank_hi = data & 0x01;
+			else if(address < 0x4000)
+				cart.rom_reg = data;
+			else if(address < 0x6000 && cart.mbc == SIM_MBC1)
+				cart.bank_hi = data & 0x03;
+			else if(address < 0x6000)
+				cart.ram_bank = data & 0x0F;
+			else if(cart.mbc == SIM_MBC1)
+				cart.mbc1_mode = data & 0x01;
+			else if(cart.mbc == SIM_MBC3)
+			{
+				//MBC3 latches the RTC on a 0 -> 1 write
+				if(cart.rtc_latch == 0 && data == 1)
+					memcpy(cart.rtc_latched,cart.rtc,sizeof(cart.rtc));
+				cart.rtc_latch = data;
+			}
+			break;
+		default:
+			break;
+	}
+}
+void _GBReset(void)
+{
+	cart.rom_reg = 0;
+	cart.bank_hi = 0;
+	cart.ram_bank = 0;
+	cart.ram_enabled = 0;
+	cart.mbc1_mode = 0;
+}
+
+//GBA
+//--------------------------------
+uint8_t _GBASaveRead(uint16_t address)
+{
+	switch(cart.save_type)
+	{
+		case SIM_SAVE_SRAM:
+			return cart.save[address % cart.save_size];
+		case SIM_SAVE_FLASH:
+			//sanyo 128KB or panasonic 64KB
+			if(cart.flash_id && address < 2)
+			{
+				if(cart.save_size > 0x10000)
+					return address == 0 ? 0x62 : 0x13;
+				return address == 0 ? 0x32 : 0x1B;
+			}
+			return cart.save[((uint32_t)cart.flash_bank << 16) | address];
+		default:
+			//carts without sram/flash read 0x00 on the save bus, which is what GBA_CheckForSave looks for
+			return 0x00;
+	}
+}
+void _GBAFlashWrite(uint16_t address, uint8_t data)
+{
+	uint32_t base = (uint32_t)cart.flash_bank << 16;
+	if(cart.flash_cmd == 0xA0)
+	{
+		//programming can only clear bits
+		cart.save[base | address] &= data;
+		cart.flash_cmd = 0;
+		return;
+	}
+	if(cart.flash_cmd == 0xB0)
+	{
+		if(address == 0x0000 && cart.save_size > 0x10000)
+			cart.flash_bank = data & 0x01;
+		cart.flash_cmd = 0;
+		return;
+	}
+	
+	switch(cart.flash_state)
+	{
+		case 0:
+			if(address == 0x5555 && data == 0xAA)
+				cart.flash_state = 1;
+			else if(data == 0xF0)
+				cart.flash_id = 0;
+			break;
+		case 1:
+			cart.flash_state = (address == 0x2AAA && data == 0x55) ? 2 : 0;
+			break;
+		default:
+			cart.flash_state = 0;
+			if(cart.flash_erase)
+			{
+				cart.flash_erase = 0;
+				if(address == 0x5555 && data == 0x10)
+					memset(cart.save,0xFF,cart.save_size);
+				else if(data == 0x30)
+					memset(&cart.save[base | (address & 0xF000)],0xFF,0x1000);
+				break;
+			}
+			if(address != 0x5555)
+				break;
+			if(data == 0x90)
+				cart.flash_id = 1;
+			else if(data == 0xF0)
+				cart.flash_id = 0;
+			else if(data == 0x80)
+				cart.flash_erase = 1;
+			else if(data == 0xA0 || data == 0xB0)
+				cart.flash_cmd = data;
+			break;
+	}
+}
+//the eeprom gets its request bit by bit on AD0 (clocked by WD) while CS1 is low, and it is handled when CS1 goes high
+void _GBAEepromRequest(void)
+{
+	uint8_t addr_bits = (cart.save_size > 0x200) ? 14 : 6;
+	uint8_t* bits = cart.eeprom_in;
+	uint16_t address = 0;
+	
+	if(cart.eeprom_count < 2 + addr_bits + 1 || bits[0] != 1)
+		return;
+	for(uint8_t i = 0;i < addr_bits;i++)
+		address = (address << 1) | bits[2 + i];
+	uint32_t offset = ((uint32_t)address * 8) % cart.save_size;
+	
+	if(bits[1] == 1 && cart.eeprom_count == 2 + addr_bits + 1)
+	{
+		memset(cart.eeprom_out,0,sizeof(cart.eeprom_out));
+		for(uint8_t i = 0;i < 64;i++)
+			cart.eeprom_out[4 + i] = (cart.save[offset + (i >> 3)] >> (7 - (i & 7))) & 0x01;
+		cart.eeprom_reading = 1;
+		cart.eeprom_pos = 0;
+	}
+	else if(bits[1] == 0 && cart.eeprom_count == 2 + addr_bits + 64 + 1)
+	{
+		for(uint8_t i = 0;i < 64;i++)
+		{
+			uint8_t mask = 1 << (7 - (i & 7));
+			uint8_t* byte = &cart.save[offset + (i >> 3)];
+			*byte = bits[2 + addr_bits + i] ? (*byte | mask) : (*byte & ~mask);
+		}
+	}
+}
+
+//bus
+//--------------------------------
+//NORMAL_MODE's SET_ADDR puts the upper byte of a latched GBA address on ADDR_PORT1, unlike Set8BitAddress.
+//there is no schematic of that board to say which one matches the wiring, so the model follows the firmware
+uint16_t _GBALatchAddress(void)
+{
+	return ((uint16_t)ADDR_PORT1 << 8) | ADDR_PORT2;
+}
+void sim_CartControl(uint8_t old_ctrl, uint8_t new_ctrl)
+{
+	if(FELL(RD))
+	{
+		sim_count.rd_strobes++;
+		if(cart.gba && cart.eeprom_reading && PIN_LOW(new_ctrl,CS1) && cart.eeprom_pos < EEPROM_OUT_BITS)
+			cart.eeprom_pos++;
+		
+		//the AVR shouldn't be driving anything the cart is about to drive
+		volatile uint8_t* ports[] = { &DATA_PORT, &ADDR_PORT1, &ADDR_PORT2 };
+		for(uint8_t i = 0;i < 3;i++)
+		{
+			uint8_t value;
+			if(*sim_DdrOf(ports[i]) != 0 && sim_CartDrive(ports[i],&value))
+				sim_count.contentions++;
+		}
+	}
+	
+	if(!cart.gba)
+	{
+		//CS2 is connected to the cart's reset
+		if(FELL(CS2))
+			_GBReset();
+		if(ROSE(WD) && !PIN_LOW(new_ctrl,RD))
+		{
+			sim_count.wd_strobes++;
+			_GBWrite(_BusAddress(),DATA_PORT);
+		}
+		return;
+	}
+	
+	if(FELL(CS1))
+	{
+		sim_count.latches++;
+		cart.address = ((uint32_t)DATA_PORT << 16) | _GBALatchAddress();
+		cart.eeprom_count = 0;
+	}
+	if(ROSE(CS1) && cart.save_type == SIM_SAVE_EEPROM)
+	{
+		if(cart.eeprom_reading && cart.eeprom_pos >= EEPROM_OUT_BITS)
+			cart.eeprom_reading = 0;
+		else if(!cart.eeprom_reading)
+			_GBAEepromRequest();
+		cart.eeprom_count = 0;
+	}
+	//the rom only keeps the lower 16 bits of the address counter
+	if(ROSE(RD) && PIN_LOW(new_ctrl,CS1))
+		cart.address = (cart.address & 0xFF0000) | ((cart.address + 1) & 0xFFFF);
+	
+	if(ROSE(WD))
+	{
+		sim_count.wd_strobes++;
+		if(PIN_LOW(new_ctrl,CS1) && cart.save_type == SIM_SAVE_EEPROM && cart.eeprom_count < sizeof(cart.eeprom_in))
+			cart.eeprom_in[cart.eeprom_count++] = ADDR_PORT1 & 0x01;
+		if(PIN_LOW(new_ctrl,CS2))
+		{
+			if(cart.save_type == SIM_SAVE_SRAM)
+				cart.save[_BusAddress() % cart.save_size] = DATA_PORT;
+			else if(cart.save_type == SIM_SAVE_FLASH)
+				_GBAFlashWrite(_BusAddress(),DATA_PORT);
+		}
+	}
+}
+uint8_t sim_CartDrive(volatile uint8_t* port, uint8_t* value)
+{
+	uint8_t ctrl = CTRL_PORT;
+	
+	if(!cart.gba)
+	{
+		if(port != &DATA_PORT || !PIN_LOW(ctrl,RD) || PIN_LOW(ctrl,CS2))
+			return 0;
+		return _GBRead(_BusAddress(),value);
+	}
+	
+	if(PIN_LOW(ctrl,CS1) && cart.eeprom_reading)
+	{
+		if(port != &ADDR_PORT1)
+			return 0;
+		*value = cart.eeprom_pos > 0 ? cart.eeprom_out[cart.eeprom_pos - 1] : 0;
+		return 1;
+	}
+	if(!PIN_LOW(ctrl,RD))
+		return 0;
+	
+	if(PIN_LOW(ctrl,CS1) && (port == &ADDR_PORT1 || port == &ADDR_PORT2))
+	{
+		uint32_t offset = (cart.address * 2) % cart.rom_size;
+		*value = cart.rom[offset + (port == &ADDR_PORT1 ? 0 : 1)];
+		return 1;
+	}
+	if(PIN_LOW(ctrl,CS2) && port == &DATA_PORT)
+	{
+		*value = _GBASaveRead(_BusAddress());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,42 @@
+/*
+gbsim - host build of the GB/C/A dumper code, running against a simulated cartridge. the cartridge model
+Copyright (C) 2018-2019  DacoTaco
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation version 2.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef _SIM_CART_H_
+#define _SIM_CART_H_
+
+#include <stdint.h>
+
+//save chips of a simulated GBA cart. GB carts get theirs from the header
+#define SIM_SAVE_NONE 0
+#define SIM_SAVE_SRAM 1
+#define SIM_SAVE_FLASH 2
+#define SIM_SAVE_EEPROM 3
+
+#define SIM_MAX_SAVE_SIZE 0x20000
+
+int8_t sim_LoadRom(const char* filename, int8_t gba);
+int8_t sim_SetRom(uint8_t* rom, uint32_t size, int8_t gba);
+int8_t sim_SetGBASave(uint8_t type, uint32_t size);
+int8_t sim_LoadSave(const char* filename);
+const uint8_t* sim_GetRom(uint32_t* size);
+const uint8_t* sim_GetSave(uint32_t* size);
+//MBC3 clock registers 0x08 - 0x0C, as they are running
+const uint8_t* sim_GetRtc(void);
+
+//called by the I/O layer when the control pins change & when the AVR reads a port
+void sim_CartControl(uint8_t old_ctrl, uint8_t new_ctrl);
+uint8_t sim_CartDrive(volatile uint8_t* port, uint8_t* value);
+
+#endif
@@ -0,0 +1,130 @@
+/*
+gbsim - host build of the GB/C/A dumper code, running against a simulated cartridge. the simulated AVR I/O
+Copyright (C) 2018-2019  DacoTaco
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation version 2.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+#include "serial.h"
+#include "gb_pins.h"
+#include "sim_io.h"
+#include "sim_cart.h"
+
+volatile uint8_t PORTA,PORTB,PORTC,PORTD;
+volatile uint8_t DDRA,DDRB,DDRC,DDRD;
+//the USART is always ready to send, so the polling paths never block
+volatile uint8_t UCSRA = _BV(UDRE) | _BV(TXC);
+volatile uint8_t UCSRB,UCSRC,UDR,UBRRH,UBRRL;
+volatile uint8_t SPDR,SPSR = _BV(SPIF),SPCR;
+volatile uint8_t TCCR0,TCNT0,TIFR,TCCR1B;
+volatile uint16_t TCNT1;
+volatile uint8_t SREG;
+
+sim_counters sim_count;
+
+void sim_ResetCounters(void)
+{
+	memset(&sim_count,0,sizeof(sim_count));
+}
+void sim_PrintCounters(const char* title)
+{
+	printf("%s :\n",title);
+	printf("\tRD strobes   : %" PRIu64 "\n",sim_count.rd_strobes);
+	printf("\tWD strobes   : %" PRIu64 "\n",sim_count.wd_strobes);
+	printf("\tGBA latches  : %" PRIu64 "\n",sim_count.latches);
+	printf("\tpin toggles  : %" PRIu64 "\n",sim_count.pin_toggles);
+	printf("\tpin reads    : %" PRIu64 "\n",sim_count.pin_reads);
+	printf("\tdelay cycles : %" PRIu64 "\n",sim_count.delay_cycles);
+	printf("\tserial bytes : %" PRIu64 "\n",sim_count.serial_bytes);
+	if(sim_count.contentions > 0)
+		printf("\tBUS CONTENTIONS : %" PRIu64 "\n",sim_count.contentions);
+}
+
+volatile uint8_t* sim_DdrOf(volatile uint8_t* port)
+{
+	if(port == &PORTA)
+		return &DDRA;
+	if(port == &PORTB)
+		return &DDRB;
+	if(port == &PORTC)
+		return &DDRC;
+	return &DDRD;
+}
+
+//the control pins are the only ones the cart reacts to on an edge, everything else is looked at when needed
+void sim_SetPin(volatile uint8_t* port, uint8_t pin)
+{
+	uint8_t old = *port;
+	*port = old | (1 << pin);
+	sim_count.pin_toggles++;
+	if(port == &CTRL_PORT)
+		sim_CartControl(old,*port);
+}
+void sim_ClearPin(volatile uint8_t* port, uint8_t pin)
+{
+	uint8_t old = *port;
+	*port = old & ~(1 << pin);
+	sim_count.pin_toggles++;
+	if(port == &CTRL_PORT)
+		sim_CartControl(old,*port);
+}
+//output pins read back what the AVR sets. input pins read what the cart drives, or the pull up state when it doesn't
+uint8_t sim_ReadPin(volatile uint8_t* port)
+{
+	uint8_t ddr = *sim_DdrOf(port);
+	uint8_t value = *port;
+	uint8_t cart = 0;
+	
+	sim_count.pin_reads++;
+	if(sim_CartDrive(port,&cart))
+		value = cart;
+	
+	return (*port & ddr) | (value & ~ddr);
+}
+void sim_Delay(uint32_t cycles)
+{
+	sim_count.delay_cycles += cycles;
+}
+
+//serial library
+//--------------------------------
+void initConsole(void)
+{
+	return;
+}
+void cprintf(const char* str)
+{
+	sim_count.serial_bytes += strlen(str);
+}
+void cprintf_char(char c)
+{
+	sim_count.serial_bytes++;
+}
+uint8_t Serial_ReadByte(void)
+{
+	return 0;
+}
+void EnableSerialInterrupt(void)
+{
+	return;
+}
+void DisableSerialInterrupt(void)
+{
+	return;
+}
+void setSerialRecvCallback(void (*callback)(char))
+{
+	return;
+}
@@ -0,0 +1,44 @@
+/*
+gbsim - host build of the GB/C/A dumper code, running against a simulated cartridge. the simulated AVR I/O
+Copyright (C) 2018-2019  DacoTaco
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation version 2.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef _SIM_IO_H_
+#define _SIM_IO_H_
+
+#include <stdint.h>
+
+//everything the dumper code did on the bus
+typedef struct _sim_counters
+{
+	uint64_t rd_strobes; //RD pulled low
+	uint64_t wd_strobes; //WD released, which is when the cart takes the write
+	uint64_t latches; //GBA rom addresses latched (CS1 pulled low)
+	uint64_t pin_toggles; //SetPin/ClearPin calls
+	uint64_t pin_reads; //PINx reads
+	uint64_t contentions; //RD strobes where the cart and the AVR were both driving the same pins
+	uint64_t delay_cycles; //cycles spend in _delay_*
+	uint64_t serial_bytes; //bytes send with the serial library
+} sim_counters;
+
+extern sim_counters sim_count;
+
+void sim_ResetCounters(void);
+void sim_PrintCounters(const char* title);
+void sim_SetPin(volatile uint8_t* port, uint8_t pin);
+void sim_ClearPin(volatile uint8_t* port, uint8_t pin);
+uint8_t sim_ReadPin(volatile uint8_t* port);
+volatile uint8_t* sim_DdrOf(volatile uint8_t* port);
+void sim_Delay(uint32_t cycles);
+
+#endif
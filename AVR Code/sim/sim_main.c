@@ -0,0 +1,208 @@
+/*
+gbsim - host build of the GB/C/A dumper code, running against a simulated cartridge.
+Copyright (C) 2018-2019  DacoTaco
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation version 2.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gb_error.h"
+#include "gb_pins.h"
+#include "8bit_cart.h"
+#include "24bit_cart.h"
+#include "gbc_api.h"
+#include "sim_io.h"
+#include "sim_cart.h"
+
+//internals of gbc_api.c that the dump loop is build from
+extern api_info gameInfo;
+void API_StartTransfer(ROM_TYPE type);
+void API_EndTransfer(ROM_TYPE type);
+void API_ReadMemory(ROM_TYPE type, uint32_t offset, uint32_t length, api_sink sink);
+int8_t API_IsRomMirror(uint32_t address);
+
+uint8_t* _dump = NULL;
+uint32_t _dump_size = 0;
+
+void _DumpSink(uint8_t data)
+{
+	_dump[_dump_size++] = data;
+}
+void _Usage(void)
+{
+	printf("usage : gbsim [options] <rom file>\n");
+	printf("\t-gba            the rom is a GBA rom\n");
+	printf("\t-ram            dump the save instead of the rom\n");
+	printf("\t-save <file>    load the cart's save memory from file\n");
+	printf("\t-gbasave <type> save chip of a GBA cart : none, sram, flash64, flash128, eeprom4k, eeprom64k (default sram)\n");
+	printf("\t-o <file>       write the dump to file\n");
+	printf("\t-trim           stop the rom dump where it starts to mirror (API_TRANSFER_TRIM)\n");
+}
+int8_t _SetGBASave(const char* type)
+{
+	if(strcmp(type,"none") == 0)
+		return sim_SetGBASave(SIM_SAVE_NONE,0);
+	if(strcmp(type,"sram") == 0)
+		return sim_SetGBASave(SIM_SAVE_SRAM,0x8000);
+	if(strcmp(type,"flash64") == 0)
+		return sim_SetGBASave(SIM_SAVE_FLASH,0x10000);
+	if(strcmp(type,"flash128") == 0)
+		return sim_SetGBASave(SIM_SAVE_FLASH,0x20000);
+	if(strcmp(type,"eeprom4k") == 0)
+		return sim_SetGBASave(SIM_SAVE_EEPROM,0x200);
+	if(strcmp(type,"eeprom64k") == 0)
+		return sim_SetGBASave(SIM_SAVE_EEPROM,0x2000);
+	return -1;
+}
+int main(int argc, char** argv)
+{
+	int8_t gba = 0;
+	ROM_TYPE type = TYPE_ROM;
+	const char* rom_file = NULL;
+	const char* save_file = NULL;
+	const char* gba_save = "sram";
+	const char* out_file = NULL;
+	int8_t trim = 0;
+	
+	for(int i = 1;i < argc;i++)
+	{
+		if(strcmp(argv[i],"-gba") == 0)
+			gba = 1;
+		else if(strcmp(argv[i],"-ram") == 0)
+			type = TYPE_RAM;
+		else if(strcmp(argv[i],"-save") == 0 && i + 1 < argc)
+			save_file = argv[++i];
+		else if(strcmp(argv[i],"-gbasave") == 0 && i + 1 < argc)
+			gba_save = argv[++i];
+		else if(strcmp(argv[i],"-o") == 0 && i + 1 < argc)
+			out_file = argv[++i];
+		else if(strcmp(argv[i],"-trim") == 0)
+			trim = 1;
+		else if(argv[i][0] != '-' && rom_file == NULL)
+			rom_file = argv[i];
+		else
+		{
+			_Usage();
+			return 1;
+		}
+	}
+	if(rom_file == NULL)
+	{
+		_Usage();
+		return 1;
+	}
+	
+	if(sim_LoadRom(rom_file,gba) < 0)
+	{
+		printf("failed to load %s\n",rom_file);
+		return 1;
+	}
+	if(gba && _SetGBASave(gba_save) < 0)
+	{
+		printf("unknown GBA save type %s\n",gba_save);
+		return 1;
+	}
+	if(save_file != NULL && sim_LoadSave(save_file) < 0)
+	{
+		printf("failed to load %s\n",save_file);
+		return 1;
+	}
+	
+	//same order as a dump command : setup, read the header, size the memory and read it
+	API_Init();
+	API_SetupPins(gba);
+	sim_ResetCounters();
+	
+	int8_t ret = API_GetGameInfo();
+	if(ret > 0)
+		ret = API_GetMemorySize(type);
+	if(ret < 0)
+	{
+		printf("failed to detect the cart : %d\n",ret);
+		return 1;
+	}
+	printf("name : %s\nsize : 0x%08" PRIX32 "\n",gameInfo.Name,gameInfo.fileSize);
+	sim_PrintCounters("detection");
+	
+	_dump = malloc(gameInfo.fileSize);
+	if(_dump == NULL)
+		return 1;
+	
+	sim_ResetCounters();
+	API_StartTransfer(type);
+	
+	//the same check the block transfer does before every bank
+	if(trim && type == TYPE_ROM)
+	{
+		for(uint32_t address = 0x8000;address < gameInfo.fileSize;address <<= 1)
+		{
+			if(API_IsRomMirror(address))
+			{
+				printf("rom mirrors from 0x%08" PRIX32 "\n",address);
+				gameInfo.fileSize = address;
+				break;
+			}
+		}
+	}
+	API_ReadMemory(type,0,gameInfo.fileSize,_DumpSink);
+	API_EndTransfer(type);
+	sim_PrintCounters("dump");
+	if(_dump_size > 0)
+		printf("\tper byte     : %.2f RD strobes, %.2f pin toggles\n",
+			(double)sim_count.rd_strobes / _dump_size,(double)sim_count.pin_toggles / _dump_size);
+	
+	//compare against what the cart holds. images smaller then the reported size are mirrored, like the real chips
+	uint32_t size = 0;
+	const uint8_t* expected = (type == TYPE_ROM)? sim_GetRom(&size) : sim_GetSave(&size);
+	uint32_t errors = 0;
+	uint32_t ram_size = _dump_size;
+	
+	//MBC3 clock carts have the clock after the ram, as the footer emulators use. the timestamp is left to the host
+	if(type == TYPE_RAM && !gba && (LoadedMBC.Flags & MBC_FLAG_RTC))
+	{
+		const uint8_t* rtc = sim_GetRtc();
+		ram_size -= GB_RTC_SIZE;
+		for(uint8_t i = 0;i < GB_RTC_SIZE;i++)
+		{
+			uint8_t data = (i < 40 && (i % 4) == 0)? rtc[(i / 4) % 5] : 0;
+			if(_dump[ram_size + i] != data)
+				errors++;
+		}
+	}
+	
+	for(uint32_t i = 0;i < ram_size && size > 0;i++)
+	{
+		uint8_t data = expected[i % size];
+		//MBC2 ram is 4 bit, the upper nibble reads as 1's
+		if(type == TYPE_RAM && !gba)
+			data |= (uint8_t)~LoadedMBC.RamMask;
+		if(_dump[i] != data)
+			errors++;
+	}
+	printf("%" PRIu32 " bytes dumped, %" PRIu32 " mismatches\n",_dump_size,errors);
+	
+	if(out_file != NULL)
+	{
+		FILE* file = fopen(out_file,"wb");
+		if(file == NULL || fwrite(_dump,1,_dump_size,file) != _dump_size)
+		{
+			printf("failed to write %s\n",out_file);
+			return 1;
+		}
+		fclose(file);
+	}
+	
+	free(_dump);
+	return errors > 0 ? 2 : 0;
+}
@@ -1,4 +1,5 @@
 ﻿using System;
+using System.Text;
 
 namespace GB_Dumper.API
 {
@@ -11,6 +12,142 @@ public struct GameInfo
         public Int32 FileSize;
         public Int32 current_addr;
         public Int32 CartType;
+        //size of the clock footer at the end of the ram transfer, 0 if there is none
+        public Int32 RtcSize;
+    }
+
+    /// <summary>
+    /// what the controller told us about itself in the handshake
+    /// </summary>
+    public class ControllerInfo
+    {
+        public byte Version = 1;
+        public byte BuildMode;
+        public ushort Signature;
+        public int CpuFrequency;
+        public int MaxBaudRate;
+        public ushort Capabilities;
+        public int MaxFrameSize = GB_API_Protocol.API_BLOCK_SIZE;
+        public int MaxCommandParameters = GB_API_Protocol.API_CMD_MAX_PARAMS;
+        public int WritePageSize = GB_API_Protocol.API_WRITE_PAGE_SIZE;
+        public int ProbeTimeout = GB_API_Protocol.API_BAUD_PROBE_TIMEOUT;
+
+        public bool IsLegacy => Version < GB_API_Protocol.API_PROTOCOL_VERSION;
+        public bool Supports(ushort capability) => (Capabilities & capability) == capability;
+
+        public static ControllerInfo Parse(byte version, byte[] payload)
+        {
+            if (payload == null || payload.Length < 19)
+                throw new ArgumentException("Failed to parse controller info : Invalid payload");
+
+            //newer versions can append fields, which we ignore
+            return new ControllerInfo
+            {
+                Version = version,
+                BuildMode = payload[0],
+                Signature = (ushort)((payload[1] << 8) | payload[2]),
+                CpuFrequency = (payload[3] << 24) | (payload[4] << 16) | (payload[5] << 8) | payload[6],
+                MaxBaudRate = (payload[7] << 24) | (payload[8] << 16) | (payload[9] << 8) | payload[10],
+                Capabilities = (ushort)((payload[11] << 8) | payload[12]),
+                MaxFrameSize = (payload[13] << 8) | payload[14],
+                MaxCommandParameters = payload[15],
+                WritePageSize = payload[16],
+                ProbeTimeout = (payload[17] << 8) | payload[18]
+            };
+        }
+
+        public override string ToString()
+        {
+            if (IsLegacy)
+                return $"Protocol version {Version} (no controller info)";
+
+            string[] modes = { "Normal", "Shifting", "GPIO Extender" };
+            string mcu;
+            switch (Signature)
+            {
+                case 0x9307:
+                    mcu = "ATmega8";
+                    break;
+                case 0x9502:
+                    mcu = "ATmega32";
+                    break;
+                default:
+                    mcu = $"0x1E{Signature.ToString("X4")}";
+                    break;
+            }
+            return $"Protocol version {Version}, {(BuildMode < modes.Length ? modes[BuildMode] : BuildMode.ToString())} mode, {mcu} @ {CpuFrequency / 1000000.0}MHz, " +
+                $"max {MaxBaudRate} baud, capabilities 0x{Capabilities.ToString("X4")}";
+        }
+    }
+
+    /// <summary>
+    /// everything the controller reports of a cart with API_CMD_GET_INFO
+    /// </summary>
+    public class CartInfo
+    {
+        public byte CartType;
+        public byte SaveType;
+        public int RomSize;
+        public int RamSize;
+        public byte[] Header;
+
+        public bool IsGBA => CartType == GB_CART_TYPE.API_GBA_ONLY;
+
+        public static CartInfo Parse(byte[] payload)
+        {
+            if (payload == null || payload.Length < GB_API_Protocol.API_INFO_SIZE)
+                throw new ArgumentException("Failed to parse cart info : Invalid payload");
+
+            var info = new CartInfo
+            {
+                CartType = payload[0],
+                SaveType = payload[1],
+                RomSize = (payload[2] << 24) | (payload[3] << 16) | (payload[4] << 8) | payload[5],
+                RamSize = (payload[6] << 24) | (payload[7] << 16) | (payload[8] << 8) | payload[9],
+                Header = new byte[payload.Length - GB_API_Protocol.API_INFO_SIZE]
+            };
+            Array.Copy(payload, GB_API_Protocol.API_INFO_SIZE, info.Header, 0, info.Header.Length);
+            return info;
+        }
+
+        private string HeaderString(int offset, int length) => Encoding.ASCII.GetString(Header, offset, length).TrimEnd('\0', ' ');
+
+        public override string ToString()
+        {
+            var text = new StringBuilder();
+            if (IsGBA)
+            {
+                //header starts at 0x00
+                byte complement = 0;
+                for (int i = 0xA0; i < 0xBD; i++)
+                    complement -= Header[i];
+                complement -= 0x19;
+
+                string[] saves = { "None", "EEPROM", "SRAM", "SRAM/Flash", "Flash" };
+                text.AppendLine($"Title : {HeaderString(0xA0, 12)}");
+                text.AppendLine($"Game Code : {HeaderString(0xAC, 4)}, Maker : {HeaderString(0xB0, 2)}, Version : {Header[0xBC]}");
+                text.AppendLine($"Header Checksum : 0x{Header[0xBD].ToString("X2")} ({(complement == Header[0xBD] ? "OK" : "BAD")})");
+                text.AppendLine($"Save Type : {(SaveType < saves.Length ? saves[SaveType] : $"0x{SaveType.ToString("X2")}")}");
+            }
+            else
+            {
+                //header starts at 0x100
+                byte checksum = 0;
+                for (int i = 0x34; i <= 0x4C; i++)
+                    checksum = (byte)(checksum - Header[i] - 1);
+
+                bool newLicensee = Header[0x4B] == 0x33;
+                text.AppendLine($"Title : {HeaderString(0x34, newLicensee ? 11 : 16)}");
+                if (newLicensee)
+                    text.AppendLine($"Game Code : {HeaderString(0x3F, 4)}, Licensee : {HeaderString(0x44, 2)}, Version : {Header[0x4C]}");
+                else
+                    text.AppendLine($"Licensee : 0x{Header[0x4B].ToString("X2")}, Version : {Header[0x4C]}");
+                text.AppendLine($"Cart Type : 0x{Header[0x47].ToString("X2")} (MBC 0x{SaveType.ToString("X2")}), CGB : 0x{Header[0x43].ToString("X2")}, SGB : 0x{Header[0x46].ToString("X2")}, Region : 0x{Header[0x4A].ToString("X2")}");
+                text.AppendLine($"Header Checksum : 0x{Header[0x4D].ToString("X2")} ({(checksum == Header[0x4D] ? "OK" : "BAD")}), Global Checksum : 0x{Header[0x4E].ToString("X2")}{Header[0x4F].ToString("X2")}");
+            }
+            text.Append($"Rom Size : 0x{RomSize.ToString("X8")}, Ram Size : 0x{RamSize.ToString("X8")}");
+            return text.ToString();
+        }
     }
 
     public class ApiInfo
@@ -0,0 +1,33 @@
+﻿using System;
+
+namespace GB_Dumper.API
+{
+    /// <summary>
+    /// checksums used by the API. these need to match the ones the controller calculates
+    /// </summary>
+    public static class GB_API_Checksum
+    {
+        /// <summary>
+        /// CRC16 XMODEM (poly 0x1021, init 0x0000). same as avr-libc's _crc_xmodem_update
+        /// </summary>
+        public static ushort Crc16(byte[] data, int offset, int count)
+        {
+            if (data == null)
+                throw new ArgumentNullException("Failed to calculate crc : Invalid arguments");
+
+            ushort crc = 0;
+            for (int i = offset; i < offset + count; i++)
+            {
+                crc ^= (ushort)(data[i] << 8);
+                for (int bit = 0; bit < 8; bit++)
+                {
+                    if ((crc & 0x8000) != 0)
+                        crc = (ushort)((crc << 1) ^ 0x1021);
+                    else
+                        crc <<= 1;
+                }
+            }
+            return crc;
+        }
+    }
+}
@@ -14,11 +14,9 @@ public static class GB_API_Protocol
         public const byte API_GAMENAME_END = 0x87;
         public const byte API_FILESIZE_START = 0x96;
         public const byte API_FILESIZE_END = 0x97;
-
-        //commands
-        public const string API_READ_ROM = "API_READ_ROM";
-        public const string API_READ_RAM = "API_READ_RAM";
-        public const string API_WRITE_RAM = "API_WRITE_RAM";
+        //ram transfers of MBC3 clock carts : API_RTC_START, footer size, API_RTC_END
+        public const byte API_RTC_START = 0xA6;
+        public const byte API_RTC_END = 0xA7;
 
         //command functions
         public const byte API_OK = 0x10;
@@ -29,21 +27,88 @@ public static class GB_API_Protocol
         public const byte API_HANDSHAKE_ACCEPT = 0x06;
         public const byte API_HANDSHAKE_DENY = 0x15;
 
+        //extended handshake : protocol version, payload size & payload after the auto detect byte
+        public const byte API_PROTOCOL_VERSION = 0x02;
+        public const byte API_BUILD_NORMAL = 0x00;
+        public const byte API_BUILD_SHIFTING = 0x01;
+        public const byte API_BUILD_GPIO_EXTENDER = 0x02;
+
+        //capabilities
+        public const ushort API_CAP_BLOCK = 0x0001;
+        public const ushort API_CAP_RLE = 0x0002;
+        public const ushort API_CAP_HASH = 0x0004;
+        public const ushort API_CAP_RESUME = 0x0008;
+        public const ushort API_CAP_PAGED_WRITE = 0x0010;
+        public const ushort API_CAP_SET_BAUD = 0x0020;
+        public const ushort API_CAP_INFO = 0x0040;
+        public const ushort API_CAP_TRIM = 0x0080;
+        public const ushort API_CAP_RTC = 0x0100;
+
         public const byte API_TASK_START = 0x20;
         public const byte API_TASK_FINISHED = 0x21;
         public const byte API_CART_MODE_AUTO = 0x22;
         public const byte API_CART_MODE_GB = 0x23;
         public const byte API_CART_MODE_GBA = 0x24;
 
-        public const byte API_MODE_READ_ROM = 0xD0;
-        public const byte API_MODE_READ_RAM = 0xD1;
-        public const byte API_MODE_WRITE_RAM = 0xD2;
+        //commands : opcode, parameter length, parameters (big endian), checksum (XOR of the other bytes)
+        public const byte API_CMD_READ_ROM = 0xD0;
+        public const byte API_CMD_READ_RAM = 0xD1;
+        public const byte API_CMD_WRITE_RAM = 0xD2;
+        public const byte API_CMD_SET_BAUD = 0xD3;
+        public const byte API_CMD_GET_INFO = 0xD4;
+        public const int API_CMD_MAX_PARAMS = 0x10;
 
         public const byte API_ABORT = 0xF0;
         public const byte API_ABORT_ERROR = 0xF1;
         public const byte API_ABORT_CMD = 0xF2;
         public const byte API_ABORT_PACKET = 0xF3;
 
+        //cart info : API_INFO_START, payload size, payload, CRC16 (XMODEM) of the payload
+        public const byte API_INFO_START = 0x34;
+        public const int API_INFO_SIZE = 0x0A;
+
+        //time the controller waits for the probe after switching baud rate, in ms
+        public const int API_BAUD_PROBE_TIMEOUT = 200;
+
+        //block transfer mode : API_BLOCK_START, sequence number (lower 16 bits), data, CRC16 (XMODEM)
+        public const byte API_BLOCK_START = 0x30;
+        public const byte API_BLOCK_END = 0x31;
+        public const byte API_BLOCK_RLE_START = 0x32;
+        public const int API_BLOCK_SIZE = 0x100;
+
+        //run length encoded frames : runs are send as API_RLE_ESCAPE, length, byte. the CRC is that of the decoded data
+        public const byte API_RLE_ESCAPE = 0xA5;
+
+        //transfer modes, given as parameter of the read commands
+        public const byte API_TRANSFER_RAW = 0x00;
+        public const byte API_TRANSFER_BLOCK = 0x01;
+        public const byte API_TRANSFER_RLE = 0x02;
+        public const byte API_TRANSFER_HASH = 0x04;
+        //GB rom in block mode : the controller stops where the rom mirrors itself, API_BLOCK_END has the real size
+        public const byte API_TRANSFER_TRIM = 0x08;
+        //a trimmed size is only valid on a power of 2 of these
+        public const int API_GB_BANK_SIZE = 0x4000;
+        //GB ram write : only the ram, the clock of MBC3 clock carts is left alone
+        public const byte API_TRANSFER_NO_RTC = 0x10;
+
+        //hash mode : API_HASH_START, CRC32 & size of the memory
+        public const byte API_HASH_START = 0x33;
+
+        //block write mode : the save is send in pages, framed like the block transfer.
+        //the window has to fit in the controller's receive buffer (API_RX_BUFFER_SIZE, 0x100)
+        public const int API_WRITE_PAGE_SIZE = 0x40;
+        public const int API_WRITE_WINDOW = 3;
+
+        //saves of MBC3 clock carts end with the clock, in the footer most emulators use :
+        //the 5 clock registers as 32 bit values, the same 5 latched & a 64 bit unix timestamp, which we fill in
+        public const int API_RTC_SIZE = 0x30;
+        //older footer with a 32 bit timestamp, which we accept when writing
+        public const int API_RTC_SHORT_SIZE = 0x2C;
+        //clock registers in the footer : seconds, minutes, hours, day low & day high
+        public const int API_RTC_REGISTERS = 5;
+        //ram sizes are a multiple of this, anything above it is the footer
+        public const int API_RAM_SIZE_ALIGN = 0x200;
+
         public const byte TYPE_ROM = 0;
         public const byte TYPE_RAM = 1;
     }
@@ -14,48 +14,122 @@ private void API_ResetVariables()
             Info.current_addr = 0;
             Info.FileSize = 0;
             Info.CartType = 0;
+            Info.RtcSize = 0;
+            receiveBuffer.Clear();
+            expectedBlock = 0;
+            nextPage = 0;
+            resendRequested = false;
+            frameBoundary = true;
+            resumeFile = null;
+            transferOffset = 0;
+            saveFooter = 0;
+            saveClock = null;
             fileHandler.CloseFile();
             API_Mode = APIMode.Open;
             _throwStatus(GB_API_Protocol.API_RESET);
             StartTime = null;
         }
+        private void API_SendCommand(byte opcode, params byte[] parameters)
+        {
+            if (parameters.Length > GB_API_Protocol.API_CMD_MAX_PARAMS)
+                throw new ArgumentException($"Failed to send command : too many parameters ({parameters.Length})");
+
+            var frame = new byte[parameters.Length + 3];
+            frame[0] = opcode;
+            frame[1] = (byte)parameters.Length;
+            Array.Copy(parameters, 0, frame, 2, parameters.Length);
+
+            byte checksum = 0;
+            for (int i = 0; i < frame.Length - 1; i++)
+                checksum ^= frame[i];
+            frame[frame.Length - 1] = checksum;
+
+            serialInterface.Write(frame, 0, frame.Length);
+        }
         private int API_AttemptAPIHandshake()
         {
             serialInterface.Write(new byte[] { GB_API_Protocol.API_HANDSHAKE_REQUEST }, 0, 1);
-            byte cnt = 0;
             AutoDetect = false;
+            Controller = new ControllerInfo();
 
-            while (cnt <= 10)
-            {
-                if (serialInterface.BytesToRead > 1)
-                {
-                    var data = serialInterface.Read(serialInterface.BytesToRead);
-                    if (data.Length > 2)
-                        return 0;
+            var data = API_ReadBytes(2, 200);
+            if (data.Length < 2)
+                return 0; //time out
 
-                    if (data[0] == GB_API_Protocol.API_HANDSHAKE_ACCEPT)
-                    {
-                        AutoDetect = data[1] == 0x01;
-                        return 1;
-                    }
-                    else if (data[0] == GB_API_Protocol.API_HANDSHAKE_DENY)
-                    {
-                        return -1;
-                    }
-                    else
-                    {
-                        return 0;
-                    }
-                }
+            if (data[0] == GB_API_Protocol.API_HANDSHAKE_DENY)
+                return -1;
+            if (data[0] != GB_API_Protocol.API_HANDSHAKE_ACCEPT)
+                return 0;
+
+            AutoDetect = data[1] == 0x01;
+
+            //newer controllers follow up with their protocol version & what they support
+            var version = API_ReadBytes(2, 50);
+            if (version.Length == 0)
+                return 1;
+            if (version.Length < 2)
+                return 0;
+
+            var payload = API_ReadBytes(version[1], 200);
+            if (payload.Length < version[1])
+                return 0;
+
+            Controller = ControllerInfo.Parse(version[0], payload);
+            return 1;
+        }
+        //read count bytes from the controller. returns less if they didn't come in time
+        private byte[] API_ReadBytes(int count, int timeout)
+        {
+            var data = new List<byte>();
+            for (int cnt = 0; data.Count < count && cnt < timeout; cnt++)
+            {
+                if (serialInterface.BytesToRead > 0)
+                    data.AddRange(serialInterface.Read(Math.Min(serialInterface.BytesToRead, count - data.Count)));
                 else
-                {
-                    System.Threading.Thread.Sleep(20);
-                    cnt++;
-                }
+                    System.Threading.Thread.Sleep(1);
+            }
+            return data.ToArray();
+        }
+        //wait for a single byte from the controller. returns -1 on time out
+        private int API_WaitForByte(int timeout)
+        {
+            for (int cnt = 0; serialInterface.BytesToRead <= 0; cnt++)
+            {
+                if (cnt >= timeout)
+                    return -1;
+                System.Threading.Thread.Sleep(1);
             }
+            return serialInterface.ReadByte();
+        }
+        //propose the fastest rates we have to the controller, until one of them works.
+        //the controller refuses rates its clock can't make, and falls back to the old rate if our probe doesn't come through.
+        private int API_NegotiateBaudRate(int baudRate)
+        {
+            if (!Controller.Supports(GB_API_Protocol.API_CAP_SET_BAUD))
+                return baudRate;
+
+            foreach (var rate in serialInterface.BaudRates.Where(r => r > baudRate && r <= Controller.MaxBaudRate).OrderByDescending(r => r))
+            {
+                API_SendCommand(GB_API_Protocol.API_CMD_SET_BAUD, (byte)(rate >> 24), (byte)(rate >> 16), (byte)(rate >> 8), (byte)rate);
+                var response = API_WaitForByte(Controller.ProbeTimeout);
+                if (response == GB_API_Protocol.API_NOK)
+                    continue;
+                if (response != GB_API_Protocol.API_OK)
+                    break;
 
-            //time out
-            return 0;
+                serialInterface.SetBaudRate(rate);
+                serialInterface.Write(new byte[] { GB_API_Protocol.API_HANDSHAKE_REQUEST }, 0, 1);
+                if (API_WaitForByte(Controller.ProbeTimeout) == GB_API_Protocol.API_HANDSHAKE_ACCEPT)
+                    return rate;
+
+                //link didn't come up. wait for the controller to give up on the probe & go back to the old rate
+                _throwWarning(this, $"Failed to switch to {rate} baud");
+                serialInterface.SetBaudRate(baudRate);
+                System.Threading.Thread.Sleep(Controller.ProbeTimeout * 2);
+                if (serialInterface.BytesToRead > 0)
+                    serialInterface.Read(serialInterface.BytesToRead);
+            }
+            return baudRate;
         }
         private bool API_HandleReadRomRam(byte[] data)
         {
@@ -91,7 +165,23 @@ private bool API_HandleReadRomRam(byte[] data)
                 else
                     filename += ".sav";
 
-                fileHandler.OpenFile(filename, FileMode.Create);
+                if (resumeFile != null)
+                {
+                    //only continue the dump if it is the same cart and the file isn't bigger than what the cart has
+                    if (!string.Equals(Path.GetFileName(resumeFile), filename, StringComparison.OrdinalIgnoreCase) || transferOffset > Info.FileSize)
+                    {
+                        serialInterface.Write(new byte[] { GB_API_Protocol.API_NOK }, 0, 1);
+                        _throwStatus(GB_API_Protocol.API_ABORT, $"Can not resume {resumeFile} : the inserted cart is {filename} (0x{Info.FileSize.ToString("X8")} bytes).{Environment.NewLine}");
+                        API_ResetVariables();
+                        return false;
+                    }
+
+                    fileHandler.OpenFile(resumeFile, FileMode.Open);
+                    fileHandler.Truncate(transferOffset);
+                    Info.current_addr = transferOffset;
+                }
+                else
+                    fileHandler.OpenFile(filename, FileMode.Create);
                 _throwStatus(GB_API_Protocol.API_TASK_START);
                 //send ok, we are ready for data
                 serialInterface.Write(new byte[] { GB_API_Protocol.API_OK },0,1);
@@ -102,25 +192,289 @@ private bool API_HandleReadRomRam(byte[] data)
             if (StartTime == null)
                 StartTime = DateTime.Now;
 
-            //check if we retrieved all data
-            if (Info.current_addr + data.Length < Info.FileSize)
+            return API_HandleBlocks(data);
+        }
+        //the controller sends the data as frames of API_BLOCK_SIZE : API_BLOCK_START, sequence number, data, CRC16
+        //(or API_BLOCK_RLE_START with run length encoded data, if compression is enabled)
+        //and closes the transfer with API_BLOCK_END + size.
+        //when resuming, the block numbers start at the offset we asked for.
+        //we only accept frames in order. a broken or missing frame is requested again with API_NOK + sequence number,
+        //after which the controller continues from that frame. anything received before the requested frame is dropped.
+        //API_BLOCK_END is only looked for where a frame ends, as the payload can contain its value.
+        //while a resend is pending it isn't answered, our API_NOK already is the answer.
+        private bool API_HandleBlocks(byte[] data)
+        {
+            receiveBuffer.AddRange(data);
+            int index = 0;
+            while (index < receiveBuffer.Count)
+            {
+                if (receiveBuffer[index] == GB_API_Protocol.API_BLOCK_START || receiveBuffer[index] == GB_API_Protocol.API_BLOCK_RLE_START)
+                {
+                    if (receiveBuffer.Count - index < 3)
+                        break;
+
+                    //sequence numbers are the lower 16 bits of the block number
+                    var seq = (ushort)((receiveBuffer[index + 1] << 8) | receiveBuffer[index + 2]);
+                    int block = expectedBlock + (short)(seq - (ushort)expectedBlock);
+                    int blockSize = Math.Min(GB_API_Protocol.API_BLOCK_SIZE, Info.FileSize - transferOffset - (block * GB_API_Protocol.API_BLOCK_SIZE));
+                    if (block < 0 || blockSize <= 0)
+                    {
+                        //not a frame
+                        API_SkipBrokenFrame(ref index);
+                        continue;
+                    }
+
+                    byte[] frame;
+                    int frameEnd = index + 3 + blockSize;
+                    if (receiveBuffer[index] == GB_API_Protocol.API_BLOCK_RLE_START)
+                    {
+                        if (!API_DecodeRle(index + 3, blockSize, out frame, out frameEnd))
+                            break;
+                    }
+                    else if (receiveBuffer.Count < frameEnd)
+                        break;
+                    else
+                        frame = receiveBuffer.GetRange(index + 3, blockSize).ToArray();
+
+                    if (receiveBuffer.Count < frameEnd + 2)
+                        break;
+
+                    var crc = (receiveBuffer[frameEnd] << 8) | receiveBuffer[frameEnd + 1];
+                    if (frame == null || crc != GB_API_Checksum.Crc16(frame, 0, frame.Length))
+                    {
+                        if (!frameBoundary || frame == null)
+                        {
+                            //a false start, or rle data we can't tell the length of. resync on the next byte
+                            API_SkipBrokenFrame(ref index);
+                            continue;
+                        }
+
+                        //a broken frame where we expected one. its length is known, so skip all of it.
+                        //if it is the frame we already asked for, the controller went back & it broke again
+                        API_RequestBlock(resendRequested && block == expectedBlock);
+                        index = frameEnd + 2;
+                        continue;
+                    }
+
+                    index = frameEnd + 2;
+                    frameBoundary = true;
+                    if (block != expectedBlock)
+                    {
+                        //a frame after the one we are missing, or one that was already on the line before our request
+                        if (block > expectedBlock)
+                            API_RequestBlock();
+                        continue;
+                    }
+
+                    fileHandler.Write(frame);
+                    Info.current_addr += frame.Length;
+                    expectedBlock++;
+                    resendRequested = false;
+                    _throwStatus(GB_API_Protocol.API_OK);
+                }
+                else if (receiveBuffer[index] == GB_API_Protocol.API_BLOCK_END && frameBoundary)
+                {
+                    if (receiveBuffer.Count - index < 5)
+                        break;
+
+                    if (resendRequested)
+                    {
+                        //the end of the frames send before our request. the controller takes our API_NOK as the answer
+                        index += 5;
+                        continue;
+                    }
+
+                    //a trimmed rom ends where it starts to mirror. the size is what was send from the offset on.
+                    //we only get here right after a good frame, and roms only mirror at a power of 2 banks
+                    var size = transferOffset + ((receiveBuffer[index + 1] << 24) | (receiveBuffer[index + 2] << 16) | (receiveBuffer[index + 3] << 8) | receiveBuffer[index + 4]);
+                    var banks = size / GB_API_Protocol.API_GB_BANK_SIZE;
+                    index += 5;
+                    if (TrimMirrors && API_Mode == APIMode.ReadRom && size < Info.FileSize && size >= Info.current_addr &&
+                        size % GB_API_Protocol.API_GB_BANK_SIZE == 0 && banks > 0 && (banks & (banks - 1)) == 0)
+                    {
+                        _throwWarning(this, $"The rom mirrors itself from 0x{size.ToString("X8")} on, the dump was trimmed to that size.");
+                        Info.FileSize = size;
+                    }
+                    if (Info.current_addr < Info.FileSize)
+                    {
+                        //the controller is waiting on our answer, so always ask for what we are missing
+                        API_RequestBlock(true);
+                        continue;
+                    }
+
+                    //everything is in, let the controller know and we are done
+                    serialInterface.Write(new byte[] { GB_API_Protocol.API_OK }, 0, 1);
+                    API_WriteRtcTimestamp();
+                    _throwStatus(GB_API_Protocol.API_TASK_FINISHED);
+                    API_ResetVariables();
+                    return true;
+                }
+                else
+                    API_SkipBrokenFrame(ref index);
+            }
+
+            receiveBuffer.RemoveRange(0, index);
+            return true;
+        }
+        //drops a byte that doesn't start a valid frame & searches for the next one.
+        //if a frame should have started there, its header is broken. the controller might be waiting on us after it,
+        //so the frame is asked for even if we did before
+        private void API_SkipBrokenFrame(ref int index)
+        {
+            if (frameBoundary)
+                API_RequestBlock(true);
+            frameBoundary = false;
+            index++;
+        }
+        //the controller has no clock, so the timestamp of the clock footer is set once the save is in.
+        //the controller latches the clock when the transfer starts. resumes restart at a block boundary and the footer
+        //follows the ram (a multiple of 0x200), so the footer always comes from the transfer that finishes the file
+        private void API_WriteRtcTimestamp()
+        {
+            if (API_Mode != APIMode.ReadRam || Info.RtcSize != GB_API_Protocol.API_RTC_SIZE)
+                return;
+
+            fileHandler.Truncate(Info.FileSize - sizeof(long));
+            fileHandler.Write(BitConverter.GetBytes(API_UnixTime(StartTime ?? DateTime.Now)));
+        }
+        private static long API_UnixTime(DateTime time)
+        {
+            return (long)(time.ToUniversalTime() - new DateTime(1970, 1, 1, 0, 0, 0, DateTimeKind.Utc)).TotalSeconds;
+        }
+        //the cart's clock kept running while the save was off the cart, so the clock registers of the footer are
+        //advanced by the time since its timestamp, like emulators do when loading it.
+        //a halted clock, or a footer without a timestamp, is written as it is
+        private static byte[] API_AdvanceRtc(byte[] footer)
+        {
+            var regs = new byte[GB_API_Protocol.API_RTC_REGISTERS];
+            for (int i = 0; i < regs.Length; i++)
+                regs[i] = footer[i * 4];
+
+            long timestamp = footer.Length == GB_API_Protocol.API_RTC_SIZE ?
+                BitConverter.ToInt64(footer, footer.Length - sizeof(long)) :
+                BitConverter.ToUInt32(footer, footer.Length - sizeof(uint));
+            long elapsed = API_UnixTime(DateTime.Now) - timestamp;
+            if (timestamp == 0 || elapsed <= 0 || (regs[4] & 0x40) != 0)
+                return regs;
+
+            //seconds, minutes, hours, day counter low & day counter bit 8 in day high. past 511 days the carry bit is set
+            long seconds = regs[0] + (regs[1] * 60L) + (regs[2] * 3600L) + ((((regs[4] & 0x01) << 8) | regs[3]) * 86400L) + elapsed;
+            long days = seconds / 86400;
+            regs[0] = (byte)(seconds % 60);
+            regs[1] = (byte)((seconds / 60) % 60);
+            regs[2] = (byte)((seconds / 3600) % 24);
+            regs[3] = (byte)days;
+            regs[4] = (byte)((regs[4] & 0xFE) | (int)((days >> 8) & 0x01) | (days > 0x1FF ? 0x80 : 0));
+            return regs;
+        }
+        //the controller hashes the rom itself and only sends API_HASH_START, CRC32, size & API_TASK_FINISHED
+        private bool API_HandleHash(byte[] data)
+        {
+            if (string.IsNullOrWhiteSpace(Info.CartName))
             {
-                fileHandler.Write(data);
-                Info.current_addr += data.Length;
-                _throwStatus(GB_API_Protocol.API_OK);
+                if (!API_ProcessHeader(data))
+                {
+                    _throwStatus(GB_API_Protocol.API_ABORT_CMD);
+                    API_ResetVariables();
+                    return false;
+                }
+
+                StartTime = DateTime.Now;
+                serialInterface.Write(new byte[] { GB_API_Protocol.API_OK }, 0, 1);
+                return true;
             }
-            else
+
+            receiveBuffer.AddRange(data);
+            int index = receiveBuffer.IndexOf(GB_API_Protocol.API_HASH_START);
+            if (index < 0 || receiveBuffer.Count - index < 10)
+                return true;
+
+            var hash = receiveBuffer.GetRange(index + 1, 8).ToArray();
+            uint crc = (uint)((hash[0] << 24) | (hash[1] << 16) | (hash[2] << 8) | hash[3]);
+            int size = (hash[4] << 24) | (hash[5] << 16) | (hash[6] << 8) | hash[7];
+            _throwInfo(this, $"{Info.CartName} : CRC32 {crc.ToString("X8")} over 0x{size.ToString("X8")} bytes (took {DateTime.Now - StartTime.Value})");
+            API_ResetVariables();
+            return true;
+        }
+        //API_INFO_START, payload size, payload & CRC16. or an abort if there is no (working) cart
+        private bool API_HandleInfo(byte[] data)
+        {
+            receiveBuffer.AddRange(data);
+            if (receiveBuffer.Count == 0)
+                return true;
+
+            //the abort is API_ABORT, the abort type & a message ending in a new line. wait for all of it
+            if (receiveBuffer[0] == GB_API_Protocol.API_ABORT)
             {
-                //end of file
-                byte[] dataToWrite = new byte[Info.FileSize - Info.current_addr];
-                Array.Copy(data, dataToWrite, Info.FileSize - Info.current_addr);
-                fileHandler.Write(dataToWrite);
-                Info.current_addr = Info.FileSize;
-                _throwStatus(GB_API_Protocol.API_TASK_FINISHED);
+                int end = receiveBuffer.IndexOf((byte)'\n', Math.Min(2, receiveBuffer.Count));
+                if (end < 0)
+                    return true;
+
+                _throwStatus(GB_API_Protocol.API_ABORT, $"Cart Error : {Encoding.ASCII.GetString(receiveBuffer.ToArray(), 2, end - 2).TrimEnd('\r')}{Environment.NewLine}");
                 API_ResetVariables();
+                return false;
             }
+
+            if (receiveBuffer[0] != GB_API_Protocol.API_INFO_START)
+                throw new InvalidDataException($"Failed to get cart info : unexpected response 0x{receiveBuffer[0].ToString("X2")}");
+
+            if (receiveBuffer.Count < 2 || receiveBuffer.Count < receiveBuffer[1] + 4)
+                return true;
+
+            var payload = receiveBuffer.GetRange(2, receiveBuffer[1]).ToArray();
+            var crc = (receiveBuffer[payload.Length + 2] << 8) | receiveBuffer[payload.Length + 3];
+            if (crc != GB_API_Checksum.Crc16(payload, 0, payload.Length))
+                throw new InvalidDataException("Failed to get cart info : checksum mismatch");
+
+            _throwInfo(this, $"Cart Info : {Environment.NewLine}{CartInfo.Parse(payload)}");
+            API_ResetVariables();
             return true;
         }
+        //decodes a run length encoded frame, starting at start in the receive buffer.
+        //returns false if not all data is in yet. decoded is null if the data does not decode to a frame of size bytes
+        private bool API_DecodeRle(int start, int size, out byte[] decoded, out int end)
+        {
+            decoded = new byte[size];
+            int length = 0;
+            end = start;
+            while (length < size)
+            {
+                if (end >= receiveBuffer.Count)
+                    return false;
+
+                if (receiveBuffer[end] != GB_API_Protocol.API_RLE_ESCAPE)
+                {
+                    decoded[length++] = receiveBuffer[end++];
+                    continue;
+                }
+
+                //run : escape, length, byte
+                if (end + 2 >= receiveBuffer.Count)
+                    return false;
+
+                int run = receiveBuffer[end + 1];
+                if (run == 0 || length + run > size)
+                {
+                    decoded = null;
+                    return true;
+                }
+
+                for (int i = 0; i < run; i++)
+                    decoded[length++] = receiveBuffer[end + 2];
+                end += 3;
+            }
+            return true;
+        }
+        private void API_RequestBlock(bool force = false)
+        {
+            //only ask once. the controller resends everything starting from the requested frame
+            if (resendRequested && !force)
+                return;
+
+            resendRequested = true;
+            _throwWarning(this, $"Block 0x{expectedBlock.ToString("X4")} was not received correctly, requesting it again.");
+            serialInterface.Write(new byte[] { GB_API_Protocol.API_NOK, (byte)(expectedBlock >> 8), (byte)expectedBlock }, 0, 3);
+        }
         private bool API_HandleWriteRam(byte[] data)
         {
             try
@@ -135,7 +489,9 @@ private bool API_HandleWriteRam(byte[] data)
                         return false;
                     }
 
-                    if (fileHandler.FileSize != Info.FileSize)
+                    //the controller sends the size of what it expects : the ram, and the clock if the save has it.
+                    //a save with the short footer is padded by the reads past the end of the file
+                    if (fileHandler.FileSize != Info.FileSize - Info.RtcSize + saveFooter)
                         throw new InvalidDataException($"Incorrect selected save size ({fileHandler.FileSize}). The Game's save is {Info.FileSize}");
 
 
@@ -145,72 +501,68 @@ private bool API_HandleWriteRam(byte[] data)
                     return true;
                 }
 
-                if (data.Length < 2)
-                {
-                    //somehow we only got 1 byte. wait to see if we get more data for a while.
-                    //if we dont, let the code handle it. it could be legit (API_TASK_START)
-                    System.Threading.Thread.Sleep(10);
-                    if (serialInterface.BytesToRead > 0)
-                    {
-                        //we have data!
-                        var buf = new List<byte>(data);
-                        foreach (var _byte in serialInterface.Read(serialInterface.BytesToRead))
-                        {
-                            buf.Add(_byte);
-                        }
-                        data = buf.ToArray();
-                    }
-
-                }
-
-                //invalid data 
-                if (data.Length > 2 || (data.Length == 1 && (data[0] != GB_API_Protocol.API_TASK_START && data[0] != GB_API_Protocol.API_TASK_FINISHED )))
-                    throw new InvalidDataException($"Unexpected data retrieved from controller : 0x{data[0].ToString("X2")}({data.Length})");
-
                 if (StartTime == null)
                     StartTime = DateTime.Now;
 
                 //the handshake is done and the controller has send an OK!
-                //this function will look as following : 
-
-                //look at what is in the first byte we received. 
-                //  -> API_TASK_START -> send OK + Byte
-                //  -> API_VERIFY -> verify the last byte. if this is ok send OK + next byte. if not ok, send NOK + last byte again
+                //we send the save in pages : API_BLOCK_START, sequence number, data, CRC16.
+                //the controller writes & verifies each page and answers with API_OK/API_NOK + sequence number.
+                //we keep API_WRITE_WINDOW pages in flight, and on a NOK we go back and send everything from that page again.
+                //  -> API_TASK_START -> send the first pages
+                //  -> API_OK + seq -> page is written, send the next one
+                //  -> API_NOK + seq -> go back to that page
+                //  -> API_TASK_FINISHED -> all done
                 //in case we get into problems -> Send ABORT (exception catch)
-
-                //proccess data we got from controller and send data
-                switch (data[0])
+                receiveBuffer.AddRange(data);
+                int index = 0;
+                while (index < receiveBuffer.Count)
                 {
-                    case GB_API_Protocol.API_TASK_START:
-                        if (Info.current_addr != 0)
-                            throw new InvalidDataException("Received API_TASK_START at an unexpected moment.");
-                        serialInterface.Write(new byte[] { GB_API_Protocol.API_OK, fileHandler[0] },0,2);
-                        break;
-                    case GB_API_Protocol.API_VERIFY:
-                        //if the data isn't correct, resend the byte
-                        if(data[1] != fileHandler[Info.current_addr])
-                        {
-                            serialInterface.Write(new byte[] { GB_API_Protocol.API_NOK, fileHandler[Info.current_addr] }, 0, 2);
-                            _throwStatus(GB_API_Protocol.API_OK);
+                    switch (receiveBuffer[index])
+                    {
+                        case GB_API_Protocol.API_TASK_START:
+                            if (Info.current_addr != 0 || nextPage != 0)
+                                throw new InvalidDataException("Received API_TASK_START at an unexpected moment.");
+                            index++;
                             break;
-                        }
-
-                        if (Info.current_addr > Info.FileSize)
-                            throw new InvalidOperationException($"Current position in ram is greater then ram size");
-
-                        _throwStatus(GB_API_Protocol.API_OK);
-                        Info.current_addr++;
-                        serialInterface.Write(new byte[] { GB_API_Protocol.API_OK, fileHandler[Info.current_addr] }, 0, 2);
-                        
-                        break;
-                    case GB_API_Protocol.API_TASK_FINISHED:
-                        _throwStatus(GB_API_Protocol.API_TASK_FINISHED);
-                        API_ResetVariables();
-                        break;
-                    default:
-                        throw new InvalidDataException($"Unexpected data retrieved from controller : {data[0].ToString("X2")}({data.Length})");
+                        case GB_API_Protocol.API_OK:
+                        case GB_API_Protocol.API_NOK:
+                            if (receiveBuffer.Count - index < 3)
+                                goto wait_for_data;
+
+                            //sequence numbers are the lower 16 bits of the page number
+                            var seq = (ushort)((receiveBuffer[index + 1] << 8) | receiveBuffer[index + 2]);
+                            int page = expectedBlock + (short)(seq - (ushort)expectedBlock);
+                            if (page < expectedBlock || page >= nextPage)
+                                throw new InvalidDataException($"Received a response for page 0x{seq.ToString("X4")} which was not send.");
+
+                            if (receiveBuffer[index] == GB_API_Protocol.API_OK)
+                            {
+                                expectedBlock = page + 1;
+                                Info.current_addr = Math.Min(expectedBlock * GB_API_Protocol.API_WRITE_PAGE_SIZE, Info.FileSize);
+                                _throwStatus(GB_API_Protocol.API_OK);
+                            }
+                            else
+                            {
+                                _throwWarning(this, $"Page 0x{page.ToString("X4")} was not written correctly, sending it again.");
+                                expectedBlock = page;
+                                nextPage = page;
+                            }
+                            index += 3;
+                            break;
+                        case GB_API_Protocol.API_TASK_FINISHED:
+                            if (Info.current_addr < Info.FileSize)
+                                throw new InvalidDataException("Received API_TASK_FINISHED before all pages were written.");
+                            _throwStatus(GB_API_Protocol.API_TASK_FINISHED);
+                            API_ResetVariables();
+                            return true;
+                        default:
+                            throw new InvalidDataException($"Unexpected data retrieved from controller : 0x{receiveBuffer[index].ToString("X2")}({receiveBuffer.Count - index})");
+                    }
                 }
 
+            wait_for_data:
+                receiveBuffer.RemoveRange(0, index);
+                API_SendPages();
                 return true;
             }
             catch (Exception e)
@@ -221,6 +573,40 @@ private bool API_HandleWriteRam(byte[] data)
                 throw e;
             }
         }
+        private void API_SendPages()
+        {
+            int pages = (Info.FileSize + GB_API_Protocol.API_WRITE_PAGE_SIZE - 1) / GB_API_Protocol.API_WRITE_PAGE_SIZE;
+            while (nextPage < pages && nextPage < expectedBlock + GB_API_Protocol.API_WRITE_WINDOW)
+            {
+                int offset = nextPage * GB_API_Protocol.API_WRITE_PAGE_SIZE;
+                int size = Math.Min(GB_API_Protocol.API_WRITE_PAGE_SIZE, Info.FileSize - offset);
+                fileHandler.Read(out var page, offset, size);
+
+                //the clock registers are send as they are now, not as they were saved
+                if (saveClock != null)
+                {
+                    int footer = fileHandler.FileSize - saveFooter;
+                    for (int i = 0; i < saveClock.Length; i++)
+                    {
+                        int reg = footer + (i * 4) - offset;
+                        if (reg >= 0 && reg < size)
+                            page[reg] = saveClock[i];
+                    }
+                }
+
+                var frame = new byte[size + 5];
+                frame[0] = GB_API_Protocol.API_BLOCK_START;
+                frame[1] = (byte)(nextPage >> 8);
+                frame[2] = (byte)nextPage;
+                Array.Copy(page, 0, frame, 3, size);
+                var crc = GB_API_Checksum.Crc16(page, 0, size);
+                frame[size + 3] = (byte)(crc >> 8);
+                frame[size + 4] = (byte)crc;
+
+                serialInterface.Write(frame, 0, frame.Length);
+                nextPage++;
+            }
+        }
         private bool API_ProcessHeader(byte[] data)
         {
             if (data == null)
@@ -298,16 +684,27 @@ private bool API_ProcessHeader(byte[] data)
                     //retrieve rom size which is in a 8 byte packet : header a b c d header_end
                     Info.FileSize = (data[i + 1] << 24) + (data[i + 2] << 16) + (data[i + 3] << 8) + data[i + 4];
 
-                    //MBC2 is 0x200(minimum) and 0x8000 max(32KB)
+                    //roms go up to 8MB (MBC5). the lower bound depends on the clock footer, which comes after the size
                     if (Info.FileSize == 0 || 
-                        (Info.CartType != GB_CART_TYPE.API_GBA_ONLY && (Info.FileSize < 0x0200 || Info.FileSize > 0x400000))
+                        (Info.CartType != GB_CART_TYPE.API_GBA_ONLY && Info.FileSize > 0x800000)
                         ) //we have an invalid valid rom or ram
                             throw new ArgumentException("Error parsing header (file size) : ERROR_INVALID_PARAM");
 
                     //skip to the bytes we need
                     i += 6;
                 }
+                if (i + 2 < data.Length && data[i] == GB_API_Protocol.API_RTC_START && data[i + 2] == GB_API_Protocol.API_RTC_END)
+                {
+                    //the ram transfer ends with the clock footer
+                    Info.RtcSize = data[i + 1];
+                    i += 2;
+                }
             }
+
+            //MBC2 is 0x200(minimum) and 0x8000 max(32KB). MBC3 clock carts without ram only have the clock
+            if (Info.FileSize != 0 && Info.CartType != GB_CART_TYPE.API_GBA_ONLY &&
+                Info.FileSize - Info.RtcSize < GB_API_Protocol.API_RAM_SIZE_ALIGN && Info.FileSize != Info.RtcSize)
+                throw new ArgumentException("Error parsing header (file size) : ERROR_INVALID_PARAM");
             return true;
         }
     }
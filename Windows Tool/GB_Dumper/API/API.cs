@@ -12,7 +12,9 @@ public enum APIMode
         Open,
         ReadRom,
         ReadRam,
-        WriteRam
+        WriteRam,
+        HashRom,
+        GetInfo
     }
 
     public partial class APIHandler
@@ -47,9 +49,27 @@ private void _throwStatus(byte status,string Msg)
         private FileHandler fileHandler = new FileHandler();
         private APIMode API_Mode;
         public bool AutoDetect { get; private set; }
+        public ControllerInfo Controller { get; private set; } = new ControllerInfo();
+        public bool Compression { get; set; }
+        public bool TrimMirrors { get; set; }
         private GameInfo Info = new GameInfo();
         private DateTime? StartTime;
 
+        //block transfer state
+        private List<byte> receiveBuffer = new List<byte>();
+        private int expectedBlock;
+        private int nextPage;
+        private bool resendRequested;
+        //the next byte is where a frame (or API_BLOCK_END) starts : after a frame with a valid CRC, or a broken one we skipped
+        private bool frameBoundary = true;
+        //dump we are resuming, and where we continue it
+        private string resumeFile;
+        private int transferOffset;
+        //clock footer of the save we are writing : none, API_RTC_SIZE or API_RTC_SHORT_SIZE
+        private int saveFooter;
+        //the clock registers of that footer, advanced to now
+        private byte[] saveClock;
+
         private SerialInterface serialInterface = SerialInterface.Instance;
         public bool FTDIMode
         {
@@ -66,6 +86,8 @@ public bool FTDIMode
         public int[] BaudRates => serialInterface.BaudRates;
         public bool IsConnected => serialInterface.IsOpen;
         public bool IsApiBusy => API_Mode != APIMode.Open;
+        private byte API_TransferMode => (byte)(((Compression && Controller.Supports(GB_API_Protocol.API_CAP_RLE)) ? GB_API_Protocol.API_TRANSFER_RLE : GB_API_Protocol.API_TRANSFER_BLOCK) |
+            ((TrimMirrors && Controller.Supports(GB_API_Protocol.API_CAP_TRIM)) ? GB_API_Protocol.API_TRANSFER_TRIM : 0));
 
         //functions
         //--------------------------------
@@ -86,13 +108,20 @@ public bool Connect(SerialDevice device,int BaudRate)
                         return false;
                     case 0:
                         _throwWarning(this, $"{Environment.NewLine}Controller did not respond correctly to the handshake. Keeping connection open...{Environment.NewLine}");
-                        goto case 1;
+                        break;
                     case 1:
-                        //handshake was successful
-                        serialInterface.OnDataToRead += Serial_DataToRead;
-                        serialInterface.OnErrorRaised += Serial_ErrorRaised;
+                        //handshake was successful, see how fast we can go
+                        _throwInfo(this, $"Controller : {Controller}");
+                        if (Controller.IsLegacy)
+                            _throwWarning(this, "Controller runs an older protocol. please update its firmware.");
+                        var rate = API_NegotiateBaudRate(BaudRate);
+                        if (rate != BaudRate)
+                            _throwInfo(this, $"Switched to {rate} baud");
                         break;
                 }
+
+                serialInterface.OnDataToRead += Serial_DataToRead;
+                serialInterface.OnErrorRaised += Serial_ErrorRaised;
             }
             catch(Exception e)
             {
@@ -135,7 +164,7 @@ public void ReadRom()
 
                 API_Mode = APIMode.ReadRom;
                 //send command!
-                serialInterface.Write($"{GB_API_Protocol.API_READ_ROM}\n");
+                API_SendCommand(GB_API_Protocol.API_CMD_READ_ROM, API_TransferMode);
             }
             catch (Exception e)
             {
@@ -143,6 +172,48 @@ public void ReadRom()
                 return ;
             }  
         }
+        public void HashRom()
+        {
+            try
+            {
+                if (!IsConnected)
+                    throw new InvalidOperationException("Failed to hash rom : Serial is not connected");
+                if (IsApiBusy)
+                    throw new InvalidOperationException("Failed to hash rom : API is not ready");
+                if (!Controller.Supports(GB_API_Protocol.API_CAP_HASH))
+                    throw new NotSupportedException("Failed to hash rom : not supported by the controller");
+
+                API_Mode = APIMode.HashRom;
+                //send command!
+                API_SendCommand(GB_API_Protocol.API_CMD_READ_ROM, GB_API_Protocol.API_TRANSFER_HASH);
+            }
+            catch (Exception e)
+            {
+                _throwException(e);
+                return;
+            }
+        }
+        public void GetInfo()
+        {
+            try
+            {
+                if (!IsConnected)
+                    throw new InvalidOperationException("Failed to get cart info : Serial is not connected");
+                if (IsApiBusy)
+                    throw new InvalidOperationException("Failed to get cart info : API is not ready");
+                if (!Controller.Supports(GB_API_Protocol.API_CAP_INFO))
+                    throw new NotSupportedException("Failed to get cart info : not supported by the controller");
+
+                API_Mode = APIMode.GetInfo;
+                //send command!
+                API_SendCommand(GB_API_Protocol.API_CMD_GET_INFO);
+            }
+            catch (Exception e)
+            {
+                _throwException(e);
+                return;
+            }
+        }
         public void ReadRam()
         {
             try
@@ -154,7 +225,7 @@ public void ReadRam()
 
                 API_Mode = APIMode.ReadRam;
                 //send command!
-                serialInterface.Write($"{GB_API_Protocol.API_READ_RAM}\n");
+                API_SendCommand(GB_API_Protocol.API_CMD_READ_RAM, API_TransferMode);
             }
             catch (Exception e)
             {
@@ -162,6 +233,42 @@ public void ReadRam()
                 return;
             }
         }
+        //continue a broken rom/ram dump from the last complete block in the file
+        public void ResumeDump(string filename)
+        {
+            try
+            {
+                if (!IsConnected)
+                    throw new InvalidOperationException("Failed to resume dump : Serial is not connected.");
+                if (IsApiBusy)
+                    throw new InvalidOperationException("Failed to resume dump : API is not ready.");
+                if (!Controller.Supports(GB_API_Protocol.API_CAP_RESUME))
+                    throw new NotSupportedException("Failed to resume dump : not supported by the controller.");
+
+                if (!File.Exists(filename))
+                    throw new FileNotFoundException($"Failed to resume dump : {filename} does not exist.");
+
+                var command = GB_API_Protocol.API_CMD_READ_ROM;
+                API_Mode = APIMode.ReadRom;
+                if (string.Equals(Path.GetExtension(filename), ".sav", StringComparison.OrdinalIgnoreCase))
+                {
+                    command = GB_API_Protocol.API_CMD_READ_RAM;
+                    API_Mode = APIMode.ReadRam;
+                }
+
+                resumeFile = filename;
+                transferOffset = (int)(new FileInfo(filename).Length / GB_API_Protocol.API_BLOCK_SIZE) * GB_API_Protocol.API_BLOCK_SIZE;
+                //send command!
+                API_SendCommand(command, API_TransferMode,
+                    (byte)(transferOffset >> 24), (byte)(transferOffset >> 16), (byte)(transferOffset >> 8), (byte)transferOffset);
+            }
+            catch (Exception e)
+            {
+                _throwException(e);
+                API_ResetVariables();
+                return;
+            }
+        }
         public void WriteRam(string filename)
         {
             try
@@ -177,8 +284,20 @@ public void WriteRam(string filename)
 
                 fileHandler.OpenFile(filename, FileMode.Open);
                 API_Mode = APIMode.WriteRam;
+
+                //a save without the clock footer only writes the ram, the clock of the cart is left as it is
+                saveFooter = fileHandler.FileSize % GB_API_Protocol.API_RAM_SIZE_ALIGN;
+                if (saveFooter != GB_API_Protocol.API_RTC_SIZE && saveFooter != GB_API_Protocol.API_RTC_SHORT_SIZE)
+                    saveFooter = 0;
+                else
+                {
+                    fileHandler.Read(out var footer, fileHandler.FileSize - saveFooter, saveFooter);
+                    saveClock = API_AdvanceRtc(footer);
+                }
+
                 //send command!
-                serialInterface.Write($"{GB_API_Protocol.API_WRITE_RAM}\n");
+                API_SendCommand(GB_API_Protocol.API_CMD_WRITE_RAM, 
+                    (byte)(GB_API_Protocol.API_TRANSFER_BLOCK | (saveFooter == 0 ? GB_API_Protocol.API_TRANSFER_NO_RTC : 0)));
             }
             catch (Exception e)
             {
@@ -206,6 +325,12 @@ private void Serial_DataToRead(object source, SerialEventArgs e)
                         if (!API_HandleReadRomRam(data))
                             API_ResetVariables();
                         break;
+                    case APIMode.HashRom:
+                        API_HandleHash(data);
+                        break;
+                    case APIMode.GetInfo:
+                        API_HandleInfo(data);
+                        break;
                     case APIMode.Open:
                     default:
                         _throwInfo(this, Encoding.ASCII.GetString(data, 0, data.Length));
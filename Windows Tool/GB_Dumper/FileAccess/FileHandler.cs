@@ -62,6 +62,16 @@ public int Write(object value)
             return FileSize;
         }
 
+        //cut the file down to length & continue writing at the end of it
+        public void Truncate(int length)
+        {
+            if (!IsOpened)
+                throw new InvalidOperationException("Failed to truncate : File Not Open");
+
+            _file.SetLength(length);
+            _file.Position = length;
+        }
+
         public int Read(out byte[] buf, int index,int count)
         {
             buf = new byte[count];
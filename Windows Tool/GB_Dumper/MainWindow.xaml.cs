@@ -53,6 +53,28 @@ public bool FTDIMode
             }
         }
 
+        //run length encode the dumps?
+        public bool Compression
+        {
+            get => apiHandler.Compression;
+            set
+            {
+                apiHandler.Compression = value;
+                OnPropertyChanged("Compression");
+            }
+        }
+
+        //stop rom dumps where the rom starts to mirror itself?
+        public bool TrimMirrors
+        {
+            get => apiHandler.TrimMirrors;
+            set
+            {
+                apiHandler.TrimMirrors = value;
+                OnPropertyChanged("TrimMirrors");
+            }
+        }
+
         //connected == busy -> false, connected == true && busy == false -> true , connected = false && busy == false -> false
         public bool EnableFunctions => Connected != apiHandler.IsApiBusy;
         public bool NotConnected => !Connected;
@@ -238,6 +260,32 @@ private void BtnGetRom_Click(object sender, RoutedEventArgs e)
             apiHandler.ReadRom();
             OnPropertyChanged("EnableFunctions");
         }
+        private void BtnGetInfo_Click(object sender, RoutedEventArgs e)
+        {
+            apiHandler.GetInfo();
+            OnPropertyChanged("EnableFunctions");
+        }
+        private void BtnHashRom_Click(object sender, RoutedEventArgs e)
+        {
+            apiHandler.HashRom();
+            OnPropertyChanged("EnableFunctions");
+        }
+        private void BtnResumeDump_Click(object sender, RoutedEventArgs e)
+        {
+            var dialog = new OpenFileDialog
+            {
+                Filter = "gameboy dump (*.gb;*.gbc;*.gba;*.sav)|*.gb;*.gbc;*.gba;*.sav|All files (*.*)|*.*",
+                FilterIndex = 1,
+                InitialDirectory = System.IO.Path.GetDirectoryName(Process.GetCurrentProcess().MainModule.FileName)
+            };
+
+
+            if (dialog.ShowDialog() == true)
+            {
+                apiHandler.ResumeDump(dialog.FileName);
+            }
+            OnPropertyChanged("EnableFunctions");
+        }
         private void BtnSendRam_Click(object sender, RoutedEventArgs e)
         {
             var dialog = new OpenFileDialog
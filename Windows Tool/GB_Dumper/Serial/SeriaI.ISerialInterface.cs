@@ -23,6 +23,7 @@ public interface ISerialInterface
         
 
         void Open(SerialDevice device, int BaudRate);
+        void SetBaudRate(int BaudRate);
         void Close();
         void Write(string data);
         void Write(byte[] data, int offset, int count);
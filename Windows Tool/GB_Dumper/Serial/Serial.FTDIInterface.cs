@@ -91,6 +91,13 @@ public void Open(SerialDevice device, int BaudRate)
             aTimer.Enabled = true;
 
         }
+        public void SetBaudRate(int BaudRate)
+        {
+            if (_FtdiDevice == null || IsOpen() == false)
+                return;
+
+            _FtdiDevice.SetBaudrate((uint)BaudRate);
+        }
         public void Close()
         {
             if (_FtdiDevice == null)
@@ -14,7 +14,7 @@ public sealed class SerialInterface
         private ISerialInterface _serialInterface;
 
         public IList<SerialDevice> Devices => _serialInterface == null ? new List<SerialDevice>() : _serialInterface.ReloadDevices();
-        public int[] BaudRates = { 300, 600, 1200, 2400, 4800, 9600, 14400, 19200, 38400, 57600, 115200, 250000, 460800, 500000, 1000000};
+        public int[] BaudRates = { 300, 600, 1200, 2400, 4800, 9600, 14400, 19200, 38400, 57600, 115200, 250000, 460800, 500000, 1000000, 2000000};
 
         private bool _FtdiMode = false;
         public bool FTDIMode
@@ -86,6 +86,13 @@ public void OpenDevice(SerialDevice device,int BaudRate)
 
             _serialInterface.Open(device,BaudRate);
         }
+        public void SetBaudRate(int BaudRate)
+        {
+            if (_serialInterface == null || IsOpen == false)
+                return;
+
+            _serialInterface.SetBaudRate(BaudRate);
+        }
         public void Close()
         {
             if (_serialInterface == null || IsOpen == false)
@@ -54,6 +54,14 @@ public void Open(SerialDevice device, int BaudRate)
             _device.Open();
         }
 
+        public void SetBaudRate(int BaudRate)
+        {
+            if (_device == null || !IsOpen())
+                return;
+
+            _device.BaudRate = BaudRate;
+        }
+
         private void _device_ErrorReceived(object sender, SerialErrorReceivedEventArgs e)
         {
             if (e.EventType == SerialError.Overrun)